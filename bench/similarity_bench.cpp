@@ -0,0 +1,218 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+// Times the LCS bound of similarity::lcs_pattern against the ratio() of
+// a reused difflib::SequenceMatcher, and checks on the way that the bound
+// is never below the ratio. There are two runs: random title-like pairs,
+// and a corpus of titles, each compared with the video names made from
+// all the others.
+//
+//     similarity-bench [pairs [titles.txt]]
+//
+// The titles file has one UTF-8 title per line; without it, the titles
+// of titles.inc are used.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "difflib.hpp"
+#include "normalize.hpp"
+#include "similarity.hpp"
+
+namespace {
+	using clock_type = std::chrono::steady_clock;
+	using movies::similarity::lcs_pattern;
+	using movies::similarity::ratio_of;
+
+	// The threshold of the differ.
+	constexpr auto min_ratio = 0.8;
+
+	std::u8string random_title(std::mt19937& rng) {
+		static constexpr std::u8string_view words[] = {
+		    u8"the",   u8"of",     u8"and",    u8"night", u8"return",
+		    u8"star",  u8"wars",   u8"king",   u8"lost",  u8"city",
+		    u8"dark",  u8"knight", u8"rises",  u8"river", u8"house",
+		    u8"2",     u8"ii",     u8"part",   u8"love",  u8"story",
+		    u8"alien", u8"blade",  u8"runner", u8"1982",  u8"2049",
+		};
+		std::uniform_int_distribution<std::size_t> count{1, 6};
+		std::uniform_int_distribution<std::size_t> pick{0,
+		                                                std::size(words) - 1};
+		std::u8string result{};
+		for (auto index = count(rng); index > 0; --index) {
+			if (!result.empty()) result.push_back(u8' ');
+			result.append(words[pick(rng)]);
+		}
+		return result;
+	}
+
+	std::vector<std::u8string> read_titles(char const* path) {
+		std::vector<std::u8string> result{};
+		if (!path) {
+			static constexpr std::u8string_view builtin[] = {
+#include "titles.inc"
+			};
+			result.assign(std::begin(builtin), std::end(builtin));
+			return result;
+		}
+
+		std::ifstream in{path};
+		std::string line{};
+		while (std::getline(in, line)) {
+			if (!line.empty() && line.back() == '\r') line.pop_back();
+			if (line.empty()) continue;
+			result.emplace_back(line.begin(), line.end());
+		}
+		return result;
+	}
+
+	// The info side of the differ: the titles, lowercased.
+	std::u8string title_key(std::u8string_view title) {
+		std::u8string result{title};
+		movies::normalize::lowercase(std::span{result});
+		return result;
+	}
+
+	// The video side: the title as a directory would be named after it,
+	// without the punctuation and with dashes between the words, and then
+	// with the dashes turned back into spaces.
+	std::u8string video_key(std::u8string_view title) {
+		std::u8string result{};
+		for (auto const c : title_key(title)) {
+			if (c == u8' ') {
+				if (!result.empty() && result.back() != u8'-')
+					result.push_back(u8'-');
+				continue;
+			}
+			auto const ascii = c < 0x80;
+			auto const alnum =
+			    (c >= u8'a' && c <= u8'z') || (c >= u8'0' && c <= u8'9');
+			if (ascii && !alnum) continue;
+			result.push_back(c);
+		}
+		movies::normalize::to_spaces(std::span{result}, u8"-_");
+		return result;
+	}
+
+	double milliseconds(clock_type::duration time) {
+		return std::chrono::duration<double, std::milli>(time).count();
+	}
+
+	struct run_result {
+		std::size_t pairs{};
+		clock_type::duration lcs{};
+		clock_type::duration difflib{};
+		double sum{};
+		std::size_t below{};
+	};
+
+	// Every key with every text; with bounded, only with the texts the
+	// differ would still compare after the real_quick_ratio() bound.
+	run_result run(std::vector<std::u8string> const& keys,
+	               std::vector<std::u8string> const& texts,
+	               bool bounded,
+	               std::size_t rounds) {
+		run_result result{};
+		std::vector<std::u8string_view> selected{};
+		std::vector<std::size_t> lengths{};
+		for (auto const& key : keys) {
+			selected.clear();
+			for (auto const& text : texts) {
+				auto const shorter = (std::min)(key.size(), text.size());
+				if (bounded &&
+				    ratio_of(shorter, key.size() + text.size()) < min_ratio)
+					continue;
+				selected.push_back(text);
+			}
+			lengths.resize(selected.size());
+			result.pairs += selected.size() * rounds;
+
+			auto start = clock_type::now();
+			lcs_pattern const pattern{key};
+			for (std::size_t round = 0; round < rounds; ++round) {
+				for (std::size_t index = 0; index < selected.size(); ++index)
+					lengths[index] = pattern.length(selected[index]);
+			}
+			result.lcs += clock_type::now() - start;
+
+			start = clock_type::now();
+			difflib::SequenceMatcher<std::u8string_view> matcher{{}, key};
+			for (std::size_t round = 0; round < rounds; ++round) {
+				for (auto const text : selected) {
+					matcher.set_seq1(text);
+					result.sum += matcher.ratio();
+				}
+			}
+			result.difflib += clock_type::now() - start;
+
+			for (std::size_t index = 0; index < selected.size(); ++index) {
+				auto const text = selected[index];
+				matcher.set_seq1(text);
+				auto const bound =
+				    ratio_of(lengths[index], key.size() + text.size());
+				if (bound < matcher.ratio()) ++result.below;
+			}
+		}
+		return result;
+	}
+
+	void print(char const* name, run_result const& result) {
+		std::printf("%s: %zu pairs\n", name, result.pairs);
+		std::printf("  lcs_pattern:         %8.1f ms\n",
+		            milliseconds(result.lcs));
+		auto const mean =
+		    result.pairs ? result.sum / static_cast<double>(result.pairs) : 0.0;
+		std::printf("  SequenceMatcher:     %8.1f ms (mean ratio %.3f)\n",
+		            milliseconds(result.difflib), mean);
+		if (result.below)
+			std::printf("  %zu bounds below the ratio\n", result.below);
+	}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+	std::size_t pairs = 400'000;
+	if (argc > 1) pairs = std::strtoul(argv[1], nullptr, 10);
+
+	// a few keys, each compared with many texts, as in the differ
+	constexpr std::size_t keys_count = 100;
+	std::mt19937 rng{20231017};
+	std::vector<std::u8string> keys(keys_count);
+	for (auto& key : keys)
+		key = random_title(rng);
+	std::vector<std::u8string> texts((std::max)(pairs / keys_count,
+	                                            std::size_t{1}));
+	for (auto& text : texts)
+		text = random_title(rng);
+	auto const random = run(keys, texts, false, 1);
+	print("random titles", random);
+
+	auto const titles = read_titles(argc > 2 ? argv[2] : nullptr);
+	if (titles.empty()) {
+		std::fprintf(stderr, "no titles in %s\n", argv[2]);
+		return 1;
+	}
+	keys.clear();
+	texts.clear();
+	for (auto const& title : titles) {
+		keys.push_back(video_key(title));
+		texts.push_back(title_key(title));
+	}
+	// the corpus is repeated, until it gives about as many pairs as the
+	// random run
+	auto const all = titles.size() * titles.size();
+	auto const rounds = (std::max)((pairs + all - 1) / all, std::size_t{1});
+	auto const corpus = run(keys, texts, false, rounds);
+	auto const bounded = run(keys, texts, true, rounds);
+	std::printf("%zu titles, %zu rounds\n", titles.size(), rounds);
+	print("corpus, all pairs", corpus);
+	print("corpus, within the length bound", bounded);
+
+	return random.below || corpus.below || bounded.below ? 1 : 0;
+}
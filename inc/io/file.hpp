@@ -6,6 +6,7 @@
 #include <cstdio>
 #include <filesystem>
 #include <memory>
+#include <span>
 #include <vector>
 
 namespace fs = std::filesystem;
@@ -23,4 +24,44 @@ namespace io {
 
 	std::vector<char8_t> contents(fs::path const&);
 	std::vector<char8_t> contents(io::file::ptr const&);
+
+	// Writes the bytes next to the file and renames them over it, so a
+	// reader sees either the old contents or the new ones, never a part
+	// of them. Returns false, leaving the old file alone, if any of the
+	// writing, closing or renaming failed.
+	bool replace_contents(fs::path const&, std::span<char8_t const> bytes);
+
+	// Read-only view of a whole file. Regular, non-empty files are mapped
+	// into memory; anything else (pipes, character devices, empty files)
+	// is read into an owned buffer, so the view is always contiguous.
+	class mapped_file {
+	public:
+		mapped_file() = default;
+		~mapped_file();
+		mapped_file(mapped_file const&) = delete;
+		mapped_file& operator=(mapped_file const&) = delete;
+		mapped_file(mapped_file&&) noexcept;
+		mapped_file& operator=(mapped_file&&) noexcept;
+
+		static mapped_file open(fs::path const&);
+
+		explicit operator bool() const noexcept { return opened_; }
+		bool is_mapped() const noexcept { return mapped_; }
+
+		char8_t const* data() const noexcept { return data_; }
+		size_t size() const noexcept { return size_; }
+		bool empty() const noexcept { return !size_; }
+		std::span<char8_t const> view() const noexcept {
+			return {data_, size_};
+		}
+
+	private:
+		void reset() noexcept;
+
+		char8_t const* data_{};
+		size_t size_{};
+		bool mapped_{};
+		bool opened_{};
+		std::vector<char8_t> buffer_{};
+	};
 }  // namespace io
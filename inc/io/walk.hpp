@@ -0,0 +1,53 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <span>
+#include <string_view>
+
+namespace fs = std::filesystem;
+
+namespace io {
+	// Single non-directory entry seen by walk(). The views are only valid
+	// for the duration of the visitor call.
+	struct walk_entry {
+		// path relative to the root of the walk, with '/' separators
+		std::u8string_view path{};
+		// extension of the file name, as found on the disk, including the
+		// dot; same rules as fs::path::extension()
+		std::u8string_view extension{};
+		// filled only if the walk was asked for the stat data
+		std::uintmax_t size{};
+		fs::file_time_type mtime{};
+
+		// the path without the extension
+		std::u8string_view stem() const noexcept {
+			return path.substr(0, path.size() - extension.size());
+		}
+	};
+
+	using walk_visitor = std::function<void(walk_entry const&)>;
+
+	// Recursively visits every non-directory entry under the root, whose
+	// extension is on the list (or every entry, if the list is empty).
+	// Symbolic links are resolved, but linked directories are not
+	// descended into, same as in fs::recursive_directory_iterator. On
+	// Linux, the tree is read with openat/getdents64, relative to the
+	// parent directory and the paths are built from the names already
+	// read; stat is only called for the entries, which pass the filter
+	// (and only if asked for) or which the file system did not give the
+	// type for.
+	//
+	// Returns false, if the root could not be opened. Throws
+	// std::system_error (fs::filesystem_error outside of Linux), if any
+	// directory under it could not be opened or read to the end, same as
+	// the iterator would; a partial tree is never reported as a whole.
+	bool walk(fs::path const& root,
+	          std::span<std::u8string_view const> extensions,
+	          bool with_stat,
+	          walk_visitor const& visitor);
+}  // namespace io
@@ -0,0 +1,260 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#pragma once
+
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <date/date.h>
+#include <movies/types.hpp>
+#include <optional>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Native-endian, length-prefixed encoding used by library snapshots. It is
+// a cache format: readers only accept data written by the same build of
+// the model (see BINARY_SCHEMA in the generated movie_info.hpp).
+
+namespace movies {
+	class binary_writer {
+	public:
+		void write(void const* data, size_t size) {
+			auto const bytes = static_cast<char8_t const*>(data);
+			bytes_.insert(bytes_.end(), bytes, bytes + size);
+		}
+
+		void write_size(size_t value) {
+			while (value >= 0x80) {
+				bytes_.push_back(static_cast<char8_t>((value & 0x7F) | 0x80));
+				value >>= 7;
+			}
+			bytes_.push_back(static_cast<char8_t>(value));
+		}
+
+		std::vector<char8_t> const& bytes() const noexcept { return bytes_; }
+
+	private:
+		std::vector<char8_t> bytes_{};
+	};
+
+	class binary_reader {
+	public:
+		explicit binary_reader(std::span<char8_t const> data) : data_{data} {}
+
+		bool read(void* data, size_t size) {
+			if (data_.size() - pos_ < size) return false;
+			std::memcpy(data, data_.data() + pos_, size);
+			pos_ += size;
+			return true;
+		}
+
+		bool read_size(size_t& value) {
+			value = 0;
+			for (unsigned shift = 0; shift < sizeof(size_t) * 8; shift += 7) {
+				if (pos_ == data_.size()) return false;
+				auto const byte = static_cast<size_t>(data_[pos_++]);
+				value |= (byte & 0x7F) << shift;
+				if (!(byte & 0x80)) return true;
+			}
+			return false;
+		}
+
+		// The view stays valid for as long as the underlying data does.
+		bool read_view(size_t size, std::span<char8_t const>& view) {
+			if (data_.size() - pos_ < size) return false;
+			view = data_.subspan(pos_, size);
+			pos_ += size;
+			return true;
+		}
+
+		size_t remaining() const noexcept { return data_.size() - pos_; }
+
+	private:
+		std::span<char8_t const> data_{};
+		size_t pos_{};
+	};
+
+	template <typename T>
+	concept StoresBinary = requires(T const& obj, binary_writer& out) {
+		obj.to_binary(out);
+	};
+
+	template <typename T>
+	concept LoadsBinary = requires(T& obj, binary_reader& in) {
+		{ obj.from_binary(in) } -> std::convertible_to<bool>;
+	};
+
+	// The enums of the model are numbered from zero, with enum_size() of
+	// any of their values (found by ADL) telling how many there are.
+	template <typename T>
+	concept BinaryEnum = std::is_enum_v<T> && requires(T value) {
+		{ enum_size(value) } -> std::convertible_to<size_t>;
+	};
+
+	template <typename T>
+	concept BinaryScalar = std::is_arithmetic_v<T> || BinaryEnum<T>;
+
+	// Everything is declared up front, so the containers below see all the
+	// overloads, no matter the order of definitions.
+	template <BinaryScalar Scalar>
+	void to_binary(binary_writer& out, Scalar value);
+	template <typename Char>
+	void to_binary(binary_writer& out, std::basic_string<Char> const& value);
+	void to_binary(binary_writer& out, date::sys_seconds const& value);
+	template <typename T>
+	void to_binary(binary_writer& out, std::optional<T> const& value);
+	template <typename T>
+	void to_binary(binary_writer& out, std::vector<T> const& value);
+	template <typename T>
+	void to_binary(binary_writer& out, translatable<T> const& value);
+	template <StoresBinary Object>
+	void to_binary(binary_writer& out, Object const& value);
+
+	template <BinaryScalar Scalar>
+	bool from_binary(binary_reader& in, Scalar& value);
+	template <typename Char>
+	bool from_binary(binary_reader& in, std::basic_string<Char>& value);
+	bool from_binary(binary_reader& in, date::sys_seconds& value);
+	template <typename T>
+	bool from_binary(binary_reader& in, std::optional<T>& value);
+	template <typename T>
+	bool from_binary(binary_reader& in, std::vector<T>& value);
+	template <typename T>
+	bool from_binary(binary_reader& in, translatable<T>& value);
+	template <LoadsBinary Object>
+	bool from_binary(binary_reader& in, Object& value);
+
+	template <BinaryScalar Scalar>
+	void to_binary(binary_writer& out, Scalar value) {
+		out.write(&value, sizeof(value));
+	}
+
+	template <typename Char>
+	void to_binary(binary_writer& out, std::basic_string<Char> const& value) {
+		static_assert(sizeof(Char) == 1);
+		out.write_size(value.size());
+		out.write(value.data(), value.size());
+	}
+
+	inline void to_binary(binary_writer& out, date::sys_seconds const& value) {
+		auto const count = value.time_since_epoch().count();
+		to_binary(out, static_cast<long long>(count));
+	}
+
+	template <typename T>
+	void to_binary(binary_writer& out, std::optional<T> const& value) {
+		to_binary(out, value.has_value());
+		if (value) to_binary(out, *value);
+	}
+
+	template <typename T>
+	void to_binary(binary_writer& out, std::vector<T> const& value) {
+		out.write_size(value.size());
+		for (auto const& item : value)
+			to_binary(out, item);
+	}
+
+	template <typename T>
+	void to_binary(binary_writer& out, translatable<T> const& value) {
+		out.write_size(value.items.size());
+		for (auto const& [key, item] : value.items) {
+			to_binary(out, key);
+			to_binary(out, item);
+		}
+	}
+
+	template <StoresBinary Object>
+	void to_binary(binary_writer& out, Object const& value) {
+		value.to_binary(out);
+	}
+
+	// A bool, or an enum, out of its range is a damaged snapshot, and not
+	// a value to copy into the object.
+	template <BinaryScalar Scalar>
+	bool from_binary(binary_reader& in, Scalar& value) {
+		if constexpr (std::is_same_v<Scalar, bool>) {
+			static_assert(sizeof(bool) == sizeof(std::uint8_t));
+			std::uint8_t raw{};
+			if (!in.read(&raw, sizeof(raw)) || raw > 1) return false;
+			value = raw != 0;
+			return true;
+		} else if constexpr (BinaryEnum<Scalar>) {
+			std::underlying_type_t<Scalar> raw{};
+			if (!in.read(&raw, sizeof(raw)) || std::cmp_less(raw, 0) ||
+			    !std::cmp_less(raw, enum_size(value)))
+				return false;
+			value = static_cast<Scalar>(raw);
+			return true;
+		} else {
+			return in.read(&value, sizeof(value));
+		}
+	}
+
+	template <typename Char>
+	bool from_binary(binary_reader& in, std::basic_string<Char>& value) {
+		static_assert(sizeof(Char) == 1);
+		size_t size{};
+		std::span<char8_t const> view{};
+		if (!in.read_size(size) || !in.read_view(size, view)) return false;
+		value.assign(reinterpret_cast<Char const*>(view.data()), view.size());
+		return true;
+	}
+
+	inline bool from_binary(binary_reader& in, date::sys_seconds& value) {
+		long long count{};
+		if (!from_binary(in, count)) return false;
+		value = date::sys_seconds{std::chrono::seconds{count}};
+		return true;
+	}
+
+	template <typename T>
+	bool from_binary(binary_reader& in, std::optional<T>& value) {
+		bool has_value{};
+		if (!from_binary(in, has_value)) return false;
+		if (!has_value) {
+			value = std::nullopt;
+			return true;
+		}
+		value.emplace();
+		return from_binary(in, *value);
+	}
+
+	template <typename T>
+	bool from_binary(binary_reader& in, std::vector<T>& value) {
+		size_t size{};
+		if (!in.read_size(size)) return false;
+		// every item takes at least one byte; do not trust the size more
+		// than what is left in the input
+		if (size > in.remaining()) return false;
+		value.clear();
+		value.resize(size);
+		for (auto& item : value) {
+			if (!from_binary(in, item)) return false;
+		}
+		return true;
+	}
+
+	template <typename T>
+	bool from_binary(binary_reader& in, translatable<T>& value) {
+		size_t size{};
+		if (!in.read_size(size)) return false;
+		value.items.clear();
+		for (size_t index = 0; index < size; ++index) {
+			language_key key{};
+			T item{};
+			if (!from_binary(in, key) || !from_binary(in, item)) return false;
+			value.items.emplace_hint(value.items.end(), std::move(key),
+			                         std::move(item));
+		}
+		return true;
+	}
+
+	template <LoadsBinary Object>
+	bool from_binary(binary_reader& in, Object& value) {
+		return value.from_binary(in);
+	}
+}  // namespace movies
@@ -3,11 +3,17 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstddef>
 #include <map>
 #include <string>
 #include <vector>
 #include "fwd.hpp"
 
+namespace movies {
+	struct fuzzy_cache;
+}  // namespace movies
+
 namespace movies::v1 {
 
 	struct diff {
@@ -16,10 +22,52 @@ namespace movies::v1 {
 		auto operator<=>(diff const&) const = default;
 	};
 
+	enum class similarity_metric {
+		// SequenceMatcher::ratio(), as in the Python difflib
+		ratio,
+		// twice the longest common subsequence over both lengths; never
+		// below the ratio, so it may match more, but it is much cheaper
+		lcs,
+	};
+
+	struct differ_counters {
+		// calls to the full similarity measure
+		std::size_t ratio_evaluations{};
+		// comparisons skipped, as the bound from the lengths alone, or
+		// from the longest common subsequence, could not reach the
+		// threshold (or the ratio the info already had)
+		std::size_t real_quick_pruned{};
+		std::size_t lcs_pruned{};
+		// pairs scored by an earlier differ
+		std::size_t fuzzy_cache_hits{};
+
+		differ_counters& operator+=(differ_counters const& rhs) noexcept {
+			ratio_evaluations += rhs.ratio_evaluations;
+			real_quick_pruned += rhs.real_quick_pruned;
+			lcs_pruned += rhs.lcs_pruned;
+			fuzzy_cache_hits += rhs.fuzzy_cache_hits;
+			return *this;
+		}
+	};
+
 	struct differ {
 		map<std::u8string, movie_info> const& jsons;
 		vector<std::u8string>& infos;
 		vector<std::u8string>& videos;
+		// if set, the counters of this calc() are added to it
+		differ_counters* counters{nullptr};
+		// threads comparing the videos; 1 keeps it on the calling thread
+		// and 0 means "as many as the hardware has"; the result does not
+		// depend on it
+		unsigned jobs{1};
+		similarity_metric metric{similarity_metric::ratio};
+		// if set, the pairs scored before are taken from it, and the new
+		// ones are added to it
+		fuzzy_cache* cache{nullptr};
+		// if set and raised by another thread, calc() gives up between two
+		// videos and returns nothing, leaving the infos and the videos as
+		// they were
+		std::atomic<bool> const* stop{nullptr};
 
 		vector<diff> calc();
 	};
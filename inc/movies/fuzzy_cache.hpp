@@ -0,0 +1,62 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <json/json.hpp>
+#include <unordered_map>
+
+namespace movies {
+	// Scores of the info/video pairs, which needed the full similarity
+	// measure, so the next differ over the same library can skip them.
+	// The pairs are keyed with the hashes of the normalized strings of
+	// both sides (and of the metric), so an info with a changed title
+	// misses the cache. Kept in the library_manifest; the entries not
+	// used for the longest time are evicted above the capacity.
+	struct fuzzy_cache {
+		struct key {
+			std::uint64_t info{};
+			std::uint64_t video{};
+
+			bool operator==(key const&) const noexcept = default;
+		};
+
+		struct score {
+			// false for the pairs, which stay below the threshold
+			bool close{};
+			// the best ratio of the pair is ratio_of(matches, length)
+			std::uint32_t matches{};
+			std::uint32_t length{};
+			// of the last differ, which has used it
+			std::uint64_t generation{};
+		};
+
+		struct key_hash {
+			std::size_t operator()(key const& k) const noexcept {
+				return static_cast<std::size_t>(k.info ^ (k.video * 31));
+			}
+		};
+
+		static constexpr std::size_t default_capacity = 64 * 1024;
+
+		std::size_t capacity{default_capacity};
+		// bumped by every differ, which uses the cache
+		std::uint64_t generation{};
+		std::unordered_map<key, score, key_hash> scores{};
+
+		score const* find(key const& k) const noexcept {
+			auto it = scores.find(k);
+			return it == scores.end() ? nullptr : &it->second;
+		}
+
+		// Drops the entries with the oldest generations, until there is
+		// no more than the capacity left.
+		void evict();
+
+		json::node to_json() const;
+		// Starts over on a mismatched version, or on a malformed node.
+		void from_json(json::node const& node);
+	};
+}  // namespace movies
@@ -0,0 +1,85 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#pragma once
+
+#include <compare>
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace movies {
+	class binary_writer;
+	class binary_reader;
+
+	// A string from the vocabulary shared by many movies (the genres,
+	// the countries, the tags). All the equal values point to the same
+	// single copy, kept in a process-wide pool, so two of them are equal
+	// if they have the same address. The pool only grows: a value, once
+	// interned, lives until the process ends, which suits a vocabulary,
+	// but not the free text.
+	//
+	// Interning takes a lock (on one of several shards of the pool);
+	// reading and copying an interned_string does not.
+	class interned_string {
+	public:
+		interned_string() noexcept;
+		interned_string(std::u8string_view value);
+		interned_string(std::u8string const& value)
+		    : interned_string{std::u8string_view{value}} {}
+		interned_string(char8_t const* value)
+		    : interned_string{std::u8string_view{value}} {}
+
+		std::u8string const& str() const noexcept { return *value_; }
+		operator std::u8string_view() const noexcept { return *value_; }
+
+		bool empty() const noexcept { return value_->empty(); }
+		std::size_t size() const noexcept { return value_->size(); }
+		auto data() const noexcept { return value_->data(); }
+
+		friend bool operator==(interned_string const& lhs,
+		                       interned_string const& rhs) noexcept {
+			return lhs.value_ == rhs.value_;
+		}
+
+		// against a value, which was not interned (and should not be
+		// just to be compared)
+		template <typename String>
+		requires(std::convertible_to<String const&, std::u8string_view> &&
+		         !std::same_as<String, interned_string>)
+		friend bool operator==(interned_string const& lhs,
+		                       String const& rhs) noexcept {
+			return *lhs.value_ == std::u8string_view{rhs};
+		}
+
+		// in the order of the values, not of the addresses, so a sorted
+		// list stays the same from one run to the next
+		friend std::strong_ordering operator<=>(
+		    interned_string const& lhs,
+		    interned_string const& rhs) noexcept {
+			if (lhs.value_ == rhs.value_) return std::strong_ordering::equal;
+			return *lhs.value_ <=> *rhs.value_;
+		}
+
+		void to_binary(binary_writer& out) const;
+		bool from_binary(binary_reader& in);
+
+		// Number of distinct values interned so far.
+		static std::size_t pool_size();
+
+		struct hash {
+			std::size_t operator()(
+			    interned_string const& value) const noexcept {
+				return std::hash<void const*>{}(value.value_);
+			}
+		};
+
+	private:
+		std::u8string const* value_;
+	};
+}  // namespace movies
+
+template <>
+struct std::hash<movies::interned_string> : movies::interned_string::hash {};
@@ -0,0 +1,162 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <movies/interned.hpp>
+#include <movies/movie_info.hpp>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define LIBRARY_NUMBER_COLUMN_X(X) \
+    X(year)                        \
+    X(runtime)                     \
+    X(rating)                      \
+    X(season_no)                   \
+    X(episode_no)
+
+#define LIBRARY_DATE_COLUMN_X(X) \
+    X(published)                 \
+    X(stream)                    \
+    X(poster)
+
+#define LIBRARY_LIST_COLUMN_X(X) \
+    X(genres)                    \
+    X(countries)                 \
+    X(tags)
+
+namespace movies {
+	// Rows of a library_table, which passed a filter; one bit per row.
+	class row_set {
+	public:
+		row_set() = default;
+		row_set(std::size_t rows, bool value);
+
+		std::size_t rows() const noexcept { return rows_; }
+		std::size_t count() const noexcept;
+		bool contains(std::size_t row) const noexcept;
+		void insert(std::size_t row) noexcept;
+		std::vector<std::size_t> indices() const;
+
+		std::span<std::uint64_t> words() noexcept { return words_; }
+		std::span<std::uint64_t const> words() const noexcept {
+			return words_;
+		}
+
+		// both sides need to come from the same table
+		row_set& operator&=(row_set const& rhs) noexcept;
+		row_set& operator|=(row_set const& rhs) noexcept;
+		row_set operator~() const;
+
+		friend row_set operator&(row_set lhs, row_set const& rhs) {
+			return lhs &= rhs;
+		}
+		friend row_set operator|(row_set lhs, row_set const& rhs) {
+			return lhs |= rhs;
+		}
+
+		bool operator==(row_set const&) const noexcept = default;
+
+	private:
+		void clear_tail() noexcept;
+
+		std::size_t rows_{};
+		std::vector<std::uint64_t> words_{};
+	};
+
+	// The attributes most often filtered on, taken out of the loaded
+	// movies into contiguous columns, one row per movie. The numbers and
+	// the dates are stored as they are (with a sentinel for a missing
+	// value); the genres, countries and tags are dictionary-encoded, as
+	// a list of codes per row. The predicates go over a column a block
+	// of rows at a time and return a row_set, to be combined with the
+	// other ones.
+	//
+	// The table is a snapshot: it does not see any later change of the
+	// movies it was built from.
+	class library_table {
+	public:
+		enum class number_column {
+#define X_DECL_COLUMN(NAME) NAME,
+			LIBRARY_NUMBER_COLUMN_X(X_DECL_COLUMN)
+#undef X_DECL_COLUMN
+		};
+
+		enum class date_column {
+#define X_DECL_COLUMN(NAME) NAME,
+			LIBRARY_DATE_COLUMN_X(X_DECL_COLUMN)
+#undef X_DECL_COLUMN
+		};
+
+		enum class list_column {
+#define X_DECL_COLUMN(NAME) NAME,
+			LIBRARY_LIST_COLUMN_X(X_DECL_COLUMN)
+#undef X_DECL_COLUMN
+		};
+
+		static constexpr auto no_number =
+		    std::numeric_limits<std::uint32_t>::max();
+		static constexpr auto no_date =
+		    std::numeric_limits<std::int64_t>::min();
+
+		// Values of one list column: the items of row r are the codes in
+		// [offsets[r], offsets[r + 1]); rows[i] is the row of codes[i].
+		struct dictionary {
+			std::vector<string_type> values{};
+			std::vector<std::uint32_t> offsets{0};
+			std::vector<std::uint32_t> codes{};
+			std::vector<std::uint32_t> rows{};
+
+			std::optional<std::uint32_t> code_of(
+			    string_type const& value) const noexcept;
+			void append(std::vector<interned_string> const& items);
+
+		private:
+			// the appends look the items up by their address, the
+			// predicates by their contents
+			std::unordered_map<interned_string, std::uint32_t> interned_{};
+			std::unordered_map<string_view_type, std::uint32_t> lookup_{};
+		};
+
+		library_table() = default;
+		explicit library_table(std::vector<loaded_movie> const& movies);
+
+		void append(loaded_movie const& movie);
+
+		std::size_t size() const noexcept { return ids_.size(); }
+		std::span<string_type const> ids() const noexcept { return ids_; }
+		std::span<std::uint32_t const> column(
+		    number_column which) const noexcept;
+		// seconds since the epoch
+		std::span<std::int64_t const> column(date_column which) const noexcept;
+		dictionary const& column(list_column which) const noexcept;
+
+		row_set all() const { return {size(), true}; }
+		// Inclusive on both ends; a row missing the value never passes.
+		row_set between(number_column which,
+		                std::uint32_t min,
+		                std::uint32_t max) const;
+		row_set between(date_column which,
+		                date::sys_seconds from,
+		                date::sys_seconds to) const;
+		row_set is(media_kind kind) const;
+		row_set has(list_column which, string_type const& value) const;
+
+	private:
+		static constexpr std::size_t number_columns = 5;
+		static constexpr std::size_t date_columns = 3;
+		static constexpr std::size_t list_columns = 3;
+
+		std::vector<string_type> ids_{};
+		std::vector<std::uint32_t> numbers_[number_columns]{};
+		std::vector<std::int64_t> dates_[date_columns]{};
+		std::vector<std::uint8_t> media_types_{};
+		dictionary lists_[list_columns]{};
+	};
+}  // namespace movies
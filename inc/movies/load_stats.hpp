@@ -0,0 +1,81 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <json/json.hpp>
+
+#define MOVIES_LOAD_TIMERS_X(X) \
+	X(info_scan)                \
+	X(video_scan)               \
+	X(json_parse)               \
+	X(from_json)                \
+	X(postproc)                 \
+	X(store)                    \
+	X(split_simple)             \
+	X(differ)                   \
+	X(assembly)                 \
+	X(total)
+
+#define MOVIES_LOAD_COUNTERS_X(X) \
+	X(info_files)                 \
+	X(video_files)                \
+	X(parsed_infos)               \
+	X(reused_infos)               \
+	X(bytes_read)                 \
+	X(ratio_evaluations)          \
+	X(real_quick_pruned)          \
+	X(lcs_pruned)                 \
+	X(fuzzy_cache_hits)           \
+	X(stored_infos)
+
+namespace movies {
+	// Where movies_config::load() spent its time. The info_scan covers the
+	// walk over dirs.infos together with the wait for the parsers; the
+	// per-file phases (json_parse, from_json, postproc and store) are
+	// summed over all the jobs, so with more than one job they may add up
+	// to more than the info_scan. The load_postproc() runs inside the
+	// generated from_json() and is timed with it; the postproc is the
+	// country mapping, which follows.
+	struct load_stats {
+		using duration = std::chrono::nanoseconds;
+
+#define X_DECL_TIMER(NAME) duration NAME{};
+		MOVIES_LOAD_TIMERS_X(X_DECL_TIMER)
+#undef X_DECL_TIMER
+
+#define X_DECL_COUNTER(NAME) std::size_t NAME{};
+		MOVIES_LOAD_COUNTERS_X(X_DECL_COUNTER)
+#undef X_DECL_COUNTER
+
+		load_stats& operator+=(load_stats const& rhs) noexcept;
+
+		// {"timers": {...}, "counters": {...}}, with the timers in
+		// nanoseconds
+		json::node to_json() const;
+
+		// Adds the time between its construction and its destruction (or
+		// the call to stop()) to the duration given.
+		class timer {
+		public:
+			explicit timer(duration& target) noexcept
+			    : target_{&target}, start_{clock::now()} {}
+			~timer() { stop(); }
+			timer(timer const&) = delete;
+			timer& operator=(timer const&) = delete;
+
+			void stop() noexcept {
+				if (!target_) return;
+				*target_ += clock::now() - start_;
+				target_ = nullptr;
+			}
+
+		private:
+			using clock = std::chrono::steady_clock;
+			duration* target_;
+			clock::time_point start_;
+		};
+	};
+}  // namespace movies
@@ -0,0 +1,84 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <movies/movie_info.hpp>
+#include <movies/watch.hpp>
+#include <optional>
+#include <span>
+#include <vector>
+
+#define LOCALIZED_FIELD_X(X) \
+    X(title)                 \
+    X(tagline)               \
+    X(summary)               \
+    X(highlight)             \
+    X(poster)
+
+namespace movies {
+	// The library as seen in one list of languages. Every translatable
+	// field of every movie is resolved once, up front, and remembered as
+	// the position of the chosen translation; reading it back for a page
+	// is then an index into two arrays. A library_delta resolves again
+	// only the movies it touches.
+	//
+	// The movies are kept here, ordered by get_id(), as the positions
+	// would mean nothing for any other copy of them.
+	class localized_library {
+	public:
+		enum class field {
+#define X_DECL_FIELD(NAME) NAME,
+			LOCALIZED_FIELD_X(X_DECL_FIELD)
+#undef X_DECL_FIELD
+		};
+
+		explicit localized_library(
+		    language_preference langs = language_preference{});
+		localized_library(std::vector<loaded_movie> movies,
+		                  language_preference langs);
+
+		// Resolves the whole library again.
+		void set_languages(language_preference langs);
+		void apply(library_delta const& delta);
+
+		std::size_t size() const noexcept { return movies_.size(); }
+		std::span<loaded_movie const> movies() const noexcept {
+			return movies_;
+		}
+		std::span<string_type const> ids() const noexcept { return ids_; }
+		std::optional<std::size_t> find(string_view_type id) const noexcept;
+
+		// nullptr, if the movie has no translation in any of the languages
+		title_info const* title(std::size_t row) const noexcept;
+		string_type const* tagline(std::size_t row) const noexcept;
+		string_type const* summary(std::size_t row) const noexcept;
+		image_url const* highlight(std::size_t row) const noexcept;
+		poster_info const* poster(std::size_t row) const noexcept;
+
+	private:
+		static constexpr std::size_t fields = 5;
+		using position = std::uint16_t;
+		static constexpr auto missing = std::numeric_limits<position>::max();
+		using picks = std::array<position, fields>;
+
+		template <typename Value>
+		position pick(translatable<Value> const& items) const noexcept;
+		template <typename Value>
+		static Value const* at(translatable<Value> const& items,
+		                       position index) noexcept;
+		picks localize(loaded_movie const& movie) const noexcept;
+		position index_of(std::size_t row, field which) const noexcept {
+			return picks_[row][static_cast<std::size_t>(which)];
+		}
+
+		language_preference langs_;
+		std::vector<loaded_movie> movies_{};
+		std::vector<string_type> ids_{};
+		std::vector<picks> picks_{};
+	};
+}  // namespace movies
@@ -0,0 +1,59 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <movies/fuzzy_cache.hpp>
+#include <movies/fwd.hpp>
+#include <movies/movie_info.hpp>
+#include <string>
+
+namespace movies {
+	struct file_stat {
+		std::uintmax_t size{};
+		// raw ticks of std::filesystem::file_time_type, not wall time
+		long long mtime{};
+
+		bool operator==(file_stat const&) const noexcept = default;
+
+		static file_stat of(fs::path const& path);
+		static file_stat of(fs::directory_entry const& entry);
+	};
+
+	// Remembers what movies_config::load has seen under dirs.infos, so the
+	// next load can skip files whose size and modification time did not
+	// change since. Persisted as a single JSON file, wherever the caller
+	// decides to keep it.
+	struct library_manifest {
+		struct entry {
+			file_stat stat{};
+			movie_info info{};
+			// debug report of a file, which needed updating, but was
+			// loaded without store_updates; replayed on every load
+			std::string debug{};
+		};
+
+		struct changes {
+			vector<fs_string> added{};
+			vector<fs_string> changed{};
+			vector<fs_string> removed{};
+
+			bool empty() const noexcept {
+				return added.empty() && changed.empty() && removed.empty();
+			}
+		};
+
+		// stat of iso-alpha-2.json; entries are only reused, if the
+		// country aliases used to post-process them are still the same
+		file_stat aliases{};
+		map<fs_string, entry> entries{};
+		changes last_scan{};
+		// scores of the fuzzy matches, which were tried before
+		fuzzy_cache fuzzy{};
+
+		bool load(fs::path const& filename);
+		bool store(fs::path const& filename) const;
+	};
+}  // namespace movies
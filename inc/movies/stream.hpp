@@ -0,0 +1,70 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#pragma once
+
+#include <iterator>
+#include <memory>
+#include <movies/fwd.hpp>
+#include <movies/movie_info.hpp>
+#include <optional>
+
+namespace movies {
+	// Hands out the movies of movies_config::load() one by one, as soon as
+	// they are known, instead of all of them at the end. The library is
+	// loaded on a background thread; the exact matches come first (in no
+	// particular order, while the rest of the infos is still parsed),
+	// followed by the fuzzy matches, the orphaned videos and the orphaned
+	// infos, in the same order as in load().
+	class library_stream {
+	public:
+		library_stream(movies_config const& cfg, bool store_updates);
+		// Stops handing the movies to the queue and waits for the
+		// background thread to notice.
+		~library_stream();
+		library_stream(library_stream&&) noexcept;
+		library_stream& operator=(library_stream&&) noexcept;
+
+		// Blocks until the next movie is known. Returns nullopt after the
+		// last one; re-throws, what the loader has thrown, once all the
+		// movies seen before the error are handed out.
+		std::optional<loaded_movie> next();
+
+		class iterator {
+		public:
+			using iterator_category = std::input_iterator_tag;
+			using value_type = loaded_movie;
+			using difference_type = std::ptrdiff_t;
+			using pointer = loaded_movie*;
+			using reference = loaded_movie&;
+
+			iterator() = default;
+			explicit iterator(library_stream* stream) : stream_{stream} {
+				++*this;
+			}
+
+			reference operator*() const { return *current_; }
+			pointer operator->() const { return &*current_; }
+			iterator& operator++() {
+				current_ = stream_->next();
+				return *this;
+			}
+			void operator++(int) { ++*this; }
+
+			bool operator==(std::default_sentinel_t) const noexcept {
+				return !current_;
+			}
+
+		private:
+			library_stream* stream_{};
+			mutable std::optional<loaded_movie> current_{};
+		};
+
+		iterator begin() { return iterator{this}; }
+		std::default_sentinel_t end() const noexcept { return {}; }
+
+	private:
+		struct impl;
+		std::unique_ptr<impl> impl_;
+	};
+}  // namespace movies
@@ -0,0 +1,90 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <movies/interned.hpp>
+#include <movies/library_table.hpp>
+#include <movies/movie_info.hpp>
+#include <movies/watch.hpp>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace movies {
+	// Answers "which movies have this genre, country or tag?" without
+	// going through the movies. Every value points to the sorted list of
+	// the documents (one per movie id), which have it; the queries turn
+	// those lists into row_sets over the documents, to be combined with
+	// &, | and ~ (or with the any_of, all_of and none_of shortcuts).
+	//
+	// Unlike library_table, the index follows the changes: insert() with
+	// a movie it already has moves only the values, which came or went,
+	// so it can be called after every add_tag(), remove_tag() or merge().
+	// The document of a removed movie is reused by the next new one; the
+	// rows of a row_set are only meaningful until then.
+	//
+	// The queries may be called from many threads at once; insert(),
+	// remove() and apply() may not run together with anything else.
+	class tag_index {
+	public:
+		using list_column = library_table::list_column;
+
+		tag_index() = default;
+		explicit tag_index(std::vector<loaded_movie> const& movies);
+
+		// Replaces the values, if the id is already known.
+		void insert(string_type const& id, movie_info const& info);
+		bool remove(string_type const& id);
+		void apply(library_delta const& delta);
+
+		std::size_t size() const noexcept { return by_id_.size(); }
+		bool contains(string_type const& id) const;
+		// Number of the movies with the value.
+		std::size_t count(list_column which, string_view_type value) const;
+
+		row_set all() const;
+		row_set has(list_column which, string_view_type value) const;
+		row_set any_of(list_column which,
+		               std::span<string_type const> values) const;
+		row_set all_of(list_column which,
+		               std::span<string_type const> values) const;
+		row_set none_of(list_column which,
+		                std::span<string_type const> values) const;
+
+		// Ids of the movies behind the rows, in the order of the rows.
+		std::vector<string_type> ids(row_set const& rows) const;
+
+	private:
+		static constexpr std::size_t list_columns = 3;
+		using document_id = std::uint32_t;
+		using postings = std::vector<document_id>;
+
+		struct document {
+			string_type id{};
+			std::array<std::vector<interned_string>, list_columns> values{};
+			bool live{};
+		};
+
+		postings const* postings_of(list_column which,
+		                            string_view_type value) const;
+		void link(std::size_t column,
+		          interned_string const& value,
+		          document_id doc);
+		void unlink(std::size_t column,
+		            interned_string const& value,
+		            document_id doc);
+
+		std::vector<document> documents_{};
+		std::vector<document_id> free_{};
+		std::unordered_map<string_type, document_id> by_id_{};
+		// the keys view the interned values, which are never freed
+		std::array<std::unordered_map<string_view_type, postings>,
+		           list_columns>
+		    postings_{};
+	};
+}  // namespace movies
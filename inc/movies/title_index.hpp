@@ -0,0 +1,54 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <movies/fwd.hpp>
+#include <movies/movie_info.hpp>
+#include <string>
+#include <string_view>
+
+namespace movies {
+	struct title_match {
+		std::u8string id;
+		double score;
+
+		auto operator<=>(title_match const&) const = default;
+	};
+
+	// Answers "which of the known movies is this?" for many queries over
+	// the same library. The ids, titles and queries are normalized and
+	// scored the way the differ does it: the score of an id is the best
+	// ratio of the query (treated as a video name) to the id and to any
+	// of its titles.
+	//
+	// search() may be called from many threads at once; insert() and
+	// remove() may not run together with anything else.
+	class title_index {
+	public:
+		title_index();
+		explicit title_index(map<std::u8string, movie_info> const& infos);
+		~title_index();
+		title_index(title_index&&) noexcept;
+		title_index& operator=(title_index&&) noexcept;
+
+		// Replaces the titles, if the id is already known.
+		void insert(std::u8string const& id, movie_info const& info);
+		bool remove(std::u8string const& id);
+
+		std::size_t size() const noexcept;
+		bool contains(std::u8string const& id) const;
+
+		// Up to k ids scoring at least min_score, best first, with the
+		// ties in the order of the ids.
+		vector<title_match> search(std::u8string_view query,
+		                           std::size_t k,
+		                           double min_score = 0.8) const;
+
+	private:
+		struct impl;
+		std::unique_ptr<impl> impl_;
+	};
+}  // namespace movies
@@ -3,10 +3,19 @@
 
 #pragma once
 
+#include <algorithm>
+#include <compare>
+#include <concepts>
 #include <filesystem>
+#include <functional>
 #include <json/json.hpp>
 #include <json/serdes.hpp>
+#include <movies/interned.hpp>
 #include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #ifdef MOVIES_HAS_NAVIGATOR
 #include <tangle/nav/navigator.hpp>
@@ -139,17 +148,225 @@ namespace movies {
 	MOVIES_USING_STR_SUITE(DUMMY, json_)
 
 	struct alpha_2_aliases;
+	class binary_reader;
+	class binary_writer;
+	struct library_manifest;
+	struct load_stats;
+	class library_stream;
+	class library_watch;
+
+	// Language of a translation ("", "en", "pl", "en-US", ...). The keys
+	// come from a small set, so they are interned: a key is as large as
+	// a pointer and comparing two of them is comparing two pointers.
+	class language_key {
+	public:
+		language_key() = default;
+		language_key(std::string_view value)
+		    : value_{view_conv<char8_t>(value)} {}
+		language_key(std::string const& value)
+		    : language_key{std::string_view{value}} {}
+		language_key(char const* value)
+		    : language_key{std::string_view{value}} {}
+
+		std::string_view view() const noexcept {
+			return view_conv<char>(std::u8string_view{value_});
+		}
+		operator std::string_view() const noexcept { return view(); }
+		std::string str() const { return std::string{view()}; }
+
+		bool empty() const noexcept { return value_.empty(); }
+		std::size_t size() const noexcept { return value_.size(); }
+		std::size_t length() const noexcept { return value_.size(); }
+
+		friend bool operator==(language_key const&,
+		                       language_key const&) noexcept = default;
+
+		template <typename String>
+		requires(std::convertible_to<String const&, std::string_view> &&
+		         !std::same_as<String, language_key>)
+		friend bool operator==(language_key const& lhs,
+		                       String const& rhs) noexcept {
+			return lhs.view() == std::string_view{rhs};
+		}
+
+		friend std::strong_ordering operator<=>(
+		    language_key const& lhs,
+		    language_key const& rhs) noexcept {
+			return lhs.value_ <=> rhs.value_;
+		}
+
+		void to_binary(binary_writer& out) const;
+		bool from_binary(binary_reader& in);
+
+	private:
+		interned_string value_{};
+	};
+
+	// Translations of one value, sorted by their language. A movie has
+	// a handful of them, so a vector beats a tree here: one allocation
+	// for all of them and a short scan to find one.
+	template <typename Value>
+	class language_map {
+	public:
+		using key_type = language_key;
+		using mapped_type = Value;
+		using value_type = std::pair<language_key, Value>;
+		using container_type = std::vector<value_type>;
+		using size_type = typename container_type::size_type;
+		using difference_type = typename container_type::difference_type;
+		using iterator = typename container_type::iterator;
+		using const_iterator = typename container_type::const_iterator;
+		using key_compare = std::less<language_key>;
+
+		bool operator==(language_map const&) const noexcept = default;
+
+		auto begin() const noexcept { return items_.begin(); }
+		auto end() const noexcept { return items_.end(); }
+		auto begin() noexcept { return items_.begin(); }
+		auto end() noexcept { return items_.end(); }
+		size_type size() const noexcept { return items_.size(); }
+		bool empty() const noexcept { return items_.empty(); }
+		void clear() noexcept { items_.clear(); }
+		void reserve(size_type size) { items_.reserve(size); }
+		key_compare key_comp() const { return {}; }
+
+		iterator find(language_key const& key) noexcept {
+			return std::find_if(items_.begin(), items_.end(),
+			                    [&](auto const& item) {
+				                    return item.first == key;
+			                    });
+		}
+
+		const_iterator find(language_key const& key) const noexcept {
+			return std::find_if(items_.begin(), items_.end(),
+			                    [&](auto const& item) {
+				                    return item.first == key;
+			                    });
+		}
+
+		iterator lower_bound(language_key const& key) noexcept {
+			return std::lower_bound(items_.begin(), items_.end(), key,
+			                        [](auto const& item, auto const& key) {
+				                        return item.first < key;
+			                        });
+		}
+
+		const_iterator lower_bound(language_key const& key) const noexcept {
+			return std::lower_bound(items_.begin(), items_.end(), key,
+			                        [](auto const& item, auto const& key) {
+				                        return item.first < key;
+			                        });
+		}
+
+		// Like std::map::insert: a key already in the map stays as it is,
+		// and a wrong hint costs a lookup, not the order of the items.
+		iterator insert(const_iterator hint, value_type value) {
+			auto const& key = value.first;
+			auto const fits =
+			    (hint == items_.begin() || std::prev(hint)->first < key) &&
+			    (hint == items_.end() || key < hint->first);
+			if (!fits) {
+				auto it = lower_bound(key);
+				if (it != items_.end() && it->first == key) return it;
+				hint = it;
+			}
+			return items_.insert(hint, std::move(value));
+		}
+
+		template <typename... Args>
+		iterator emplace_hint(const_iterator hint, Args&&... args) {
+			return insert(hint, value_type{std::forward<Args>(args)...});
+		}
+
+		Value& operator[](language_key const& key) {
+			auto it = lower_bound(key);
+			if (it == items_.end() || it->first != key)
+				it = items_.insert(it, {key, Value{}});
+			return it->second;
+		}
+
+		iterator erase(const_iterator pos) { return items_.erase(pos); }
+
+		size_type erase(language_key const& key) {
+			auto it = find(key);
+			if (it == items_.end()) return 0;
+			items_.erase(it);
+			return 1;
+		}
+
+	private:
+		container_type items_{};
+	};
+
+	// The order, in which translatable<>::find looks for a translation,
+	// worked out once. With the same preference reused for all the
+	// movies, finding a translation neither allocates nor compares any
+	// text.
+	class language_preference {
+	public:
+		// The language, then the ones it is a variant of ("en-GB",
+		// "en"), then "en-US", "en" and the untagged value.
+		explicit language_preference(std::string_view lang = {}) {
+			while (!lang.empty()) {
+				add(lang);
+				auto pos = lang.rfind('-');
+				if (pos == std::string_view::npos) pos = 0;
+				lang = lang.substr(0, pos);
+			}
+			add_fallback();
+		}
+
+		// The languages as given, then the untagged value, then "en-US"
+		// and "en", unless both were already on the list.
+		explicit language_preference(std::span<std::string const> langs) {
+			using namespace std::literals;
+			bool has_en_US = false;
+			bool has_en = false;
+			for (auto const& lang : langs) {
+				if (lang == "en-US"sv) has_en_US = true;
+				if (lang == "en"sv) has_en = true;
+				add(lang);
+			}
+			add({});
+			if (!has_en_US || !has_en) add_fallback();
+		}
+
+		std::span<language_key const> chain() const noexcept {
+			return chain_;
+		}
+
+		static language_preference const& fallback() {
+			static language_preference const english{};
+			return english;
+		}
+
+	private:
+		void add(language_key const& key) {
+			// a language already tried would not be found the second time
+			if (std::find(chain_.begin(), chain_.end(), key) == chain_.end())
+				chain_.push_back(key);
+		}
+
+		void add_fallback() {
+			add("en-US");
+			add("en");
+			add({});
+		}
+
+		std::vector<language_key> chain_{};
+	};
 
 	template <typename Value>
 	struct translatable {
-		using map_t = std::map<std::string, Value>;
+		using map_t = language_map<Value>;
+		using key_type = language_key;
 		using value_type = Value;
 		using const_iterator = typename map_t::const_iterator;
 		map_t items{};
 
 		bool operator==(translatable const&) const noexcept = default;
 
-		bool update(std::string const& key, Value const& value) {
+		bool update(language_key const& key, Value const& value) {
 			auto it = items.lower_bound(key);
 			if (it == items.end() || it->first != key) {
 				items.insert(it, {key, value});
@@ -167,40 +384,26 @@ namespace movies {
 		auto begin() { return items.begin(); }
 		auto end() { return items.end(); }
 
+		const_iterator find(language_preference const& langs) const {
+			for (auto const& lang : langs.chain()) {
+				auto it = items.find(lang);
+				if (it != items.end()) return it;
+			}
+			return items.end();
+		}
+
 		const_iterator fallback() const {
-			std::string en[] = {"en-US"s, "en"s};
-			return find(en);
+			return find(language_preference::fallback());
 		}
 
+		// For a single lookup; for many, build the language_preference
+		// once and use the find above.
 		const_iterator find(std::string_view lang) const {
-			using namespace std::literals;
-			while (!lang.empty()) {
-				auto it = items.find({lang.data(), lang.size()});
-				if (it != items.end()) return it;
-
-				auto pos = lang.rfind('-');
-				if (pos == std::string_view::npos) pos = 0;
-				lang = lang.substr(0, pos);
-			}
-			return fallback();
+			return find(language_preference{lang});
 		}
 
 		const_iterator find(std::span<std::string const> langs) const {
-			using namespace std::literals;
-			bool has_en_US = false;
-			bool has_en = false;
-			for (auto const& lang : langs) {
-				if (lang == "en-US"sv) has_en_US = true;
-				if (lang == "en"sv) has_en = true;
-
-				auto it = items.find(lang);
-				if (it != items.end()) return it;
-			}
-
-			auto it = items.find({});
-			if (it != items.end()) return it;
-			if (!has_en_US || !has_en) return fallback();
-			return items.end();
+			return find(language_preference{langs});
 		}
 
 		template <typename Op>
@@ -209,8 +412,9 @@ namespace movies {
 			translatable<
 			    std::remove_cvref_t<decltype(op(std::declval<Value>()))>>
 			    result{};
+			result.items.reserve(items.size());
 			for (auto const& [key, value] : items) {
-				result.items[key] = op(value);
+				result.items.emplace_hint(result.items.end(), key, op(value));
 			}
 			return result;
 		}
@@ -0,0 +1,57 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <movies/fwd.hpp>
+#include <movies/movie_info.hpp>
+#include <optional>
+
+namespace movies {
+	struct library_delta {
+		vector<loaded_movie> added{};
+		vector<loaded_movie> changed{};
+		// get_id() of the movies, which left the library
+		vector<string_type> removed{};
+
+		bool empty() const noexcept {
+			return added.empty() && changed.empty() && removed.empty();
+		}
+	};
+
+	// Keeps the result of movies_config::load() up to date, without
+	// rescanning the whole library. On Linux, dirs.infos and dirs.videos
+	// are watched recursively with inotify; only the nfo files, which
+	// changed are parsed again and only the ids, which lost their match
+	// (or are new) go through the differ. Other systems fall back to
+	// a full rescan every time next() times out.
+	class library_watch {
+	public:
+		library_watch(movies_config const& cfg, bool store_updates);
+		~library_watch();
+		library_watch(library_watch&&) noexcept;
+		library_watch& operator=(library_watch&&) noexcept;
+
+		// Current state of the library, ordered by get_id(). Safe to
+		// call from any thread, also while next() is running.
+		vector<loaded_movie> movies() const;
+
+		// Blocks until there is a non-empty delta to report. Returns
+		// nullopt, if nothing changed within the timeout, or when the
+		// watch was stopped. Negative timeout waits forever. Calls from
+		// many threads are served one after another.
+		std::optional<library_delta> next(
+		    std::chrono::milliseconds timeout = std::chrono::milliseconds{-1});
+
+		// Wakes up next() and makes it return nullopt from now on; safe to
+		// call from any thread.
+		void stop();
+		bool stopped() const noexcept;
+
+	private:
+		struct impl;
+		std::unique_ptr<impl> impl_;
+	};
+}  // namespace movies
@@ -7,6 +7,7 @@
 #include <json/json.hpp>
 #include <movies/db_info.hpp>
 #include <movies/opt.hpp>
+#include "normalize.hpp"
 
 namespace movies {
 	using namespace std::literals;
@@ -14,7 +15,7 @@ namespace movies {
 	bool alpha_2_aliases::load(fs::path const& db_root) {
 		auto const json_filename = db_root / "iso-alpha-2.json"sv;
 
-		auto const data = io::contents(json_filename);
+		auto const data = io::mapped_file::open(json_filename);
 		auto node = json::read_json({data.data(), data.size()});
 		auto ptr = cast<json::map>(node);
 		if (!ptr) return false;
@@ -25,8 +26,7 @@ namespace movies {
 				for (auto const& node : *json_aliases) {
 					if (auto item = json::cast<json::string>(node)) {
 						auto name = *item;
-						for (auto& c : name)
-							c = std::tolower(static_cast<unsigned char>(c));
+						normalize::lowercase(std::span{name});
 						aliases[as_string(std::move(name))] = as_view(code);
 					}
 				}
@@ -42,7 +42,7 @@ namespace movies {
 
 		std::unordered_map<string_type, string_type> result{};
 
-		auto const data = io::contents(json_filename);
+		auto const data = io::mapped_file::open(json_filename);
 		auto node = json::read_json({data.data(), data.size()});
 		auto ptr = cast<json::map>(node);
 		if (!ptr) return result;
@@ -66,8 +66,7 @@ namespace movies {
 		}
 
 		auto lower = country;
-		for (auto& c : lower)
-			c = std::tolower(static_cast<unsigned char>(c));
+		normalize::lowercase(std::span{lower});
 
 		auto it = aliases.find(lower);
 		if (it != aliases.end()) {
@@ -80,7 +79,7 @@ namespace movies {
 	bool ref_renames::load(fs::path const& db_root, string_view_type domain) {
 		auto const json_filename = db_root / "refs.json"sv;
 
-		auto const data = io::contents(json_filename);
+		auto const data = io::mapped_file::open(json_filename);
 		auto node = json::read_json({data.data(), data.size()});
 		auto ptr = cast_from_json<json::map>(node, as_json_string_v(domain));
 		if (!ptr) return false;
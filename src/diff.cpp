@@ -1,79 +1,456 @@
 // Copyright (c) 2021 midnightBITS
 // This code is licensed under MIT license (see LICENSE for details)
 
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <queue>
+#include <span>
+#include <unordered_set>
 #include <movies/db_info.hpp>
 #include <movies/diff.hpp>
+#include <movies/fuzzy_cache.hpp>
 #include <movies/movie_info.hpp>
-#include "difflib.hpp"
+#include "fuzzy.hpp"
+#include "parallel.hpp"
 
 namespace movies {
 	namespace {
-		inline double similar(std::u8string_view a, std::u8string_view b) {
-			return difflib::MakeSequenceMatcher(a, b).ratio();
+		using namespace fuzzy;
+
+		// This trully is a magic number
+		constexpr auto min_ratio = 0.8;  // NOLINT
+
+		// The normalized strings of one side of the differ, kept in a
+		// single buffer, so normalizing a library is a handful of
+		// allocations, not one per string.
+		class key_storage {
+		public:
+			template <typename Normalize>
+			void add(std::u8string_view text, Normalize normalize) {
+				auto const offset = text_.size();
+				text_.append(text);
+				normalize(std::span{text_}.subspan(offset));
+				ranges_.push_back({offset, text.size()});
+			}
+
+			std::u8string_view operator[](size_t index) const noexcept {
+				auto const [offset, length] = ranges_[index];
+				return std::u8string_view{text_}.substr(offset, length);
+			}
+
+			size_t size() const noexcept { return ranges_.size(); }
+
+		private:
+			std::u8string text_{};
+			std::vector<std::pair<size_t, size_t>> ranges_{};
+		};
+
+		// What an info is compared with: its id and all its titles, as
+		// the [first, first + count) strings of the storage.
+		struct info_keys {
+			std::u8string const* id;
+			size_t first;
+			size_t count;
+			// of all the strings, for the fuzzy_cache
+			std::uint64_t hash{};
+		};
+
+		info_keys keys_of(key_storage& storage,
+		                  std::u8string const& id,
+		                  movie_info const& mv) {
+			info_keys result{.id = &id, .first = storage.size(), .count = 0};
+			for_each_key(id, mv, [&](std::u8string_view text, auto normalize) {
+				storage.add(text, normalize);
+				++result.count;
+			});
+			return result;
+		}
+
+		// Anything changing the scores of the pairs (the normalization,
+		// the threshold, the measures) needs a new version, so the scores
+		// kept from the older runs are not reused.
+		constexpr std::uint64_t scores_version = 2;
+
+		// FNV-1a; unlike std::hash, the same on every run.
+		class stable_hash {
+		public:
+			explicit stable_hash(similarity_metric metric) {
+				add(scores_version);
+				add(static_cast<std::uint64_t>(metric));
+			}
+
+			void add(std::uint64_t value) {
+				for (int shift = 0; shift < 64; shift += 8)
+					add_byte(static_cast<unsigned char>(value >> shift));
+			}
+
+			// the strings are separated by a byte never seen in UTF-8
+			void add(std::u8string_view text) {
+				for (auto const c : text)
+					add_byte(static_cast<unsigned char>(c));
+				add_byte(0xFF);
+			}
+
+			std::uint64_t value() const noexcept { return value_; }
+
+		private:
+			void add_byte(unsigned char c) {
+				value_ ^= c;
+				value_ *= 0x100000001B3ull;
+			}
+
+			std::uint64_t value_{0xCBF29CE484222325ull};
+		};
+
+		posting_index index_of(std::vector<info_keys> const& infos,
+		                       key_storage const& storage) {
+			posting_index result{};
+			for (size_t owner = 0; owner < infos.size(); ++owner) {
+				auto const& info = infos[owner];
+				for (auto index = info.first; index < info.first + info.count;
+				     ++index)
+					result.add(owner, storage[index]);
+			}
+			return result;
+		}
+
+		// Close calls of a single video, best first (the ties in the
+		// descending order of the ids, as in std::greater<diff>). Only the
+		// best few are kept; if they are all taken by better videos, the
+		// video is matched again against the infos still free.
+		struct video_calls {
+			struct call {
+				double ratio;
+				size_t owner;
+			};
+
+			static constexpr size_t kept = 4;
+
+			std::vector<call> best{};
+			size_t next{};
+			bool truncated{};
+		};
+
+		// What one thread has found, apart from the calls.
+		struct match_buffer {
+			differ_counters counters{};
+			std::vector<std::pair<fuzzy_cache::key, fuzzy_cache::score>>
+			    new_scores{};
+			std::vector<fuzzy_cache::key> cache_hits{};
+		};
+
+		// What all the threads share, read-only.
+		struct match_context {
+			std::vector<info_keys> const& keys;
+			key_storage const& info_storage;
+			similarity_metric metric;
+			fuzzy_cache const* cache;
+		};
+
+		// Scratch space of one thread.
+		struct video_scratch {
+			explicit video_scratch(posting_index const& index)
+			    : index{index} {}
+
+			posting_index const& index;
+			posting_index::query query{};
+			std::vector<fuzzy_cache::score const*> cached{};
+			std::vector<std::u8string_view> texts{};
+			std::vector<size_t> lcs{};
+			std::vector<size_t> owners{};
+		};
+
+		// The LCS ratio of all the strings of all the candidates, which
+		// are not in the cache, is computed up front, in one batch. The
+		// video is the second sequence of the matcher, so its index is
+		// built once and reused for every info compared with it. The infos
+		// already taken, if given, are not compared at all.
+		void match_videos(match_context const& ctx,
+		                  video_scratch& scratch,
+		                  std::u8string_view video_key,
+		                  std::uint64_t video_hash,
+		                  std::unordered_set<std::u8string> const* taken,
+		                  video_calls& calls,
+		                  match_buffer& out) {
+			calls = {};
+			auto& candidates = scratch.owners;
+			candidates.clear();
+			auto const& found =
+			    scratch.query.candidates(scratch.index, video_key, min_ratio);
+			for (auto const owner : found) {
+				if (taken && taken->count(*ctx.keys[owner].id)) continue;
+				candidates.push_back(owner);
+			}
+			if (candidates.empty()) return;
+
+			scratch.cached.clear();
+			scratch.texts.clear();
+			for (auto const owner : candidates) {
+				auto const& info = ctx.keys[owner];
+				auto const cached =
+				    ctx.cache ? ctx.cache->find({info.hash, video_hash})
+				              : nullptr;
+				scratch.cached.push_back(cached);
+				if (cached) continue;
+
+				for (auto index = info.first; index < info.first + info.count;
+				     ++index) {
+					auto const text = ctx.info_storage[index];
+					if (length_bound(text, video_key) < min_ratio) continue;
+					scratch.texts.push_back(text);
+				}
+			}
+			scratch.lcs.resize(scratch.texts.size());
+			similarity::lcs_pattern const pattern{video_key};
+			pattern.lengths(scratch.texts, scratch.lcs);
+
+			std::optional<matcher> similar{};
+			size_t next_lcs = 0;
+			for (size_t candidate = 0; candidate < candidates.size();
+			     ++candidate) {
+				auto const& info = ctx.keys[candidates[candidate]];
+
+				if (auto const cached = scratch.cached[candidate]) {
+					++out.counters.fuzzy_cache_hits;
+					out.cache_hits.push_back({info.hash, video_hash});
+					if (cached->close) {
+						calls.best.push_back(
+						    {similarity::ratio_of(cached->matches,
+						                          cached->length),
+						     candidates[candidate]});
+					}
+					continue;
+				}
+
+				auto ratio = 0.0;
+				fuzzy_cache::score best{};
+				size_t evaluations = 0;
+				for (auto index = info.first; index < info.first + info.count;
+				     ++index) {
+					auto const text = ctx.info_storage[index];
+					auto const length = text.size() + video_key.size();
+					auto const bound = length_bound(text, video_key);
+					if (bound < min_ratio) {
+						++out.counters.real_quick_pruned;
+						continue;
+					}
+					auto const lcs = scratch.lcs[next_lcs++];
+
+					auto matches = lcs;
+					if (ctx.metric == similarity_metric::ratio) {
+						// a string, which cannot beat both, cannot change
+						// the outcome for this info
+						auto const floor = (std::max)(ratio, min_ratio);
+						if (bound < floor) {
+							++out.counters.real_quick_pruned;
+							continue;
+						}
+						if (similarity::ratio_of(lcs, length) < floor) {
+							++out.counters.lcs_pruned;
+							continue;
+						}
+
+						if (!similar)
+							similar.emplace(std::u8string_view{}, video_key);
+						similar->set_seq1(text);
+						matches = matches_of(*similar);
+					}
+
+					++evaluations;
+					auto const next_ratio =
+					    similarity::ratio_of(matches, length);
+					if (next_ratio > ratio) {
+						ratio = next_ratio;
+						best.matches = static_cast<std::uint32_t>(matches);
+						best.length = static_cast<std::uint32_t>(length);
+					}
+				}
+				out.counters.ratio_evaluations += evaluations;
+
+				best.close = ratio >= min_ratio;
+				if (ctx.cache && evaluations)
+					out.new_scores.push_back({{info.hash, video_hash}, best});
+
+				if (!best.close) continue;
+
+				calls.best.push_back({ratio, candidates[candidate]});
+			}
+
+			auto const better = [&](video_calls::call const& lhs,
+			                        video_calls::call const& rhs) {
+				if (lhs.ratio != rhs.ratio) return lhs.ratio > rhs.ratio;
+				return *ctx.keys[lhs.owner].id > *ctx.keys[rhs.owner].id;
+			};
+			auto& best = calls.best;
+			if (best.size() > video_calls::kept) {
+				std::nth_element(best.begin(),
+				                 best.begin() + (video_calls::kept - 1),
+				                 best.end(), better);
+				best.resize(video_calls::kept);
+				best.shrink_to_fit();
+				calls.truncated = true;
+			}
+			std::sort(best.begin(), best.end(), better);
 		}
 
 		vector<diff> diffs(map<std::u8string, movie_info> const& jsons,
 		                   vector<std::u8string>& infos,
-		                   vector<std::u8string>& videos) {
-			vector<diff> close_calls{};
-			close_calls.reserve(infos.size() * videos.size());
-
-			alpha_2_aliases empty{};
+		                   vector<std::u8string>& videos,
+		                   unsigned jobs,
+		                   similarity_metric metric,
+		                   fuzzy_cache* cache,
+		                   std::atomic<bool> const* stop,
+		                   differ_counters& counters) {
+			auto const stopped = [stop] {
+				return stop && stop->load(std::memory_order_relaxed);
+			};
 
+			key_storage info_storage{};
+			std::vector<info_keys> keys{};
+			keys.reserve(infos.size());
 			for (auto const& info : infos) {
 				auto it = jsons.find(info);
 				if (it == jsons.end()) [[unlikely]]
 					continue;
-				auto const& mv = it->second;
+				keys.push_back(keys_of(info_storage, info, it->second));
+			}
 
-				auto info_key = info;
-				for (auto& c : info_key) {
-					if (c == '-' || c == '_') c = ' ';
-				}
+			key_storage video_storage{};
+			for (auto const& video : videos)
+				video_storage.add(video, spaced);
 
-				std::vector<string_type> titles{};
-				titles.reserve(mv.title.items.size());
-				for (auto const& [_, title] : mv.title.items) {
-					titles.push_back(title.text);
+			std::vector<std::uint64_t> video_hashes(videos.size());
+			if (cache) {
+				for (auto& info : keys) {
+					stable_hash hash{metric};
+					for (auto index = info.first;
+					     index < info.first + info.count; ++index)
+						hash.add(info_storage[index]);
+					info.hash = hash.value();
 				}
-				for (auto& s : titles) {
-					for (auto& c : s) {
-						c = std::tolower(static_cast<unsigned char>(c));
-					}
+				for (size_t video = 0; video < videos.size(); ++video) {
+					stable_hash hash{metric};
+					hash.add(video_storage[video]);
+					video_hashes[video] = hash.value();
 				}
+			}
 
-				for (auto const& video : videos) {
-					auto video_key = video;
-					for (auto& c : video_key) {
-						if (c == '-' || c == '_') c = ' ';
-					}
+			auto const index = index_of(keys, info_storage);
+			match_context const ctx{keys, info_storage, metric, cache};
 
-					auto ratio = similar(info_key, video_key);
-					for (auto const& title : titles) {
-						auto const next_ratio =
-						    similar(as_utf8_view(title), video_key);
-						ratio = (std::max)(ratio, next_ratio);
-					}
+			auto const workers = (std::min)(
+			    effective_jobs(jobs),
+			    static_cast<unsigned>((std::max)(videos.size(), size_t{1})));
+			std::vector<match_buffer> buffers(workers);
+			std::vector<video_calls> calls(videos.size());
+			if (workers == 1) {
+				video_scratch scratch{index};
+				for (size_t video = 0; video < videos.size() && !stopped();
+				     ++video)
+					match_videos(ctx, scratch, video_storage[video],
+					             video_hashes[video], nullptr, calls[video],
+					             buffers.front());
+			} else {
+				std::atomic<size_t> next_video{0};
+				worker_group pool{workers, [&](unsigned worker) {
+					                  video_scratch scratch{index};
+					                  auto& out = buffers[worker];
+					                  while (!stopped()) {
+						                  auto const video = next_video++;
+						                  if (video >= videos.size()) break;
+						                  match_videos(ctx, scratch,
+						                               video_storage[video],
+						                               video_hashes[video],
+						                               nullptr, calls[video],
+						                               out);
+					                  }
+				                  }};
+				pool.wait();
+			}
+			if (stopped()) return {};
 
-					// This trully is a magic number
-					if (ratio < 0.8) continue;  // NOLINT
+			for (auto const& buffer : buffers)
+				counters += buffer.counters;
 
-					close_calls.push_back({ratio, video, info});
+			if (cache) {
+				auto const generation = ++cache->generation;
+				for (auto const& buffer : buffers) {
+					for (auto const& key : buffer.cache_hits)
+						cache->scores[key].generation = generation;
+					for (auto const& [key, score] : buffer.new_scores) {
+						auto& entry = cache->scores[key];
+						entry = score;
+						entry.generation = generation;
+					}
 				}
+				cache->evict();
 			}
 
-			std::sort(close_calls.begin(), close_calls.end(),
-			          std::greater<diff>{});
 			std::unordered_set<std::u8string> used_infos;
 			std::unordered_set<std::u8string> used_videos;
 
+			// The greedy assignment takes the best of all the close calls,
+			// whose video and info are both still free. Each video has its
+			// best free call in the queue; a call, whose info was taken
+			// since, is replaced by the next best of the same video, which
+			// cannot be better, so the calls leave the queue in the order
+			// of sorting them all, without having them all at once.
+			std::optional<video_scratch> refresh_scratch{};
+			auto const next_call = [&](size_t video) {
+				auto& item = calls[video];
+				while (true) {
+					while (item.next < item.best.size() &&
+					       used_infos.count(
+					           *keys[item.best[item.next].owner].id))
+						++item.next;
+					if (item.next < item.best.size()) return true;
+					if (!item.truncated) return false;
+
+					if (!refresh_scratch) refresh_scratch.emplace(index);
+					match_buffer out{};
+					match_videos(ctx, *refresh_scratch, video_storage[video],
+					             video_hashes[video], &used_infos, item, out);
+					counters += out.counters;
+				}
+			};
+
+			auto const current = [&](size_t video) -> auto const& {
+				auto const& item = calls[video];
+				return item.best[item.next];
+			};
+			auto const worse = [&](size_t lhs, size_t rhs) {
+				auto const& left = current(lhs);
+				auto const& right = current(rhs);
+				if (left.ratio != right.ratio) return left.ratio < right.ratio;
+				if (videos[lhs] != videos[rhs])
+					return videos[lhs] < videos[rhs];
+				return *keys[left.owner].id < *keys[right.owner].id;
+			};
+			std::priority_queue<size_t, std::vector<size_t>, decltype(worse)>
+			    queue{worse};
+			for (size_t video = 0; video < videos.size(); ++video) {
+				if (!calls[video].best.empty()) queue.push(video);
+			}
+
 			vector<diff> result{};
-			for (auto& D : close_calls) {
-				if (used_infos.count(D.info) || used_videos.count(D.video))
+			while (!queue.empty()) {
+				// the matches are only taken out of the lists at the end
+				if (stopped()) return {};
+				auto const video = queue.top();
+				queue.pop();
+				if (used_videos.count(videos[video])) continue;
+
+				auto const& call = current(video);
+				auto const& info = *keys[call.owner].id;
+				if (used_infos.count(info)) {
+					if (next_call(video)) queue.push(video);
 					continue;
-				used_infos.insert(D.info);
-				used_videos.insert(D.video);
-				result.push_back(std::move(D));
+				}
+
+				used_infos.insert(info);
+				used_videos.insert(videos[video]);
+				result.push_back({call.ratio, videos[video], info});
 			}
 
 			std::erase_if(infos, [&used_infos](std::u8string const& s) {
@@ -86,5 +463,11 @@ namespace movies {
 		}
 	}  // namespace
 
-	vector<diff> differ::calc() { return diffs(jsons, infos, videos); }
+	vector<diff> differ::calc() {
+		differ_counters local{};
+		auto result =
+		    diffs(jsons, infos, videos, jobs, metric, cache, stop, local);
+		if (counters) *counters += local;
+		return result;
+	}
 }  // namespace movies
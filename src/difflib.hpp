@@ -27,6 +27,7 @@
 #define __DIFFLIB__
 
 #include <algorithm>
+#include <array>
 #include <functional>
 #include <iostream>
 #include <iterator>
@@ -34,6 +35,7 @@
 #include <map>
 #include <memory>
 #include <set>
+#include <span>
 #include <string>
 #include <tuple>
 #include <type_traits>
@@ -117,6 +119,202 @@ namespace difflib {
 		    (sizeof(matcher<T>(nullptr)) == sizeof(has_op));
 	};
 
+	namespace detail {
+		// Where each element of b is, once the junk and the popular
+		// elements are dropped.
+		template <class T, class = void>
+		class b2j_index {
+		public:
+			using hashable_type = typename T::value_type;
+			using junk_function_type =
+			    std::function<bool(hashable_type const&)>;
+
+			void build(T const& b,
+			           junk_function_type const& is_junk,
+			           bool auto_junk,
+			           std::size_t auto_junk_minsize) {
+				size_t index = 0;
+
+				// Counting occurences
+				b2j_.clear();
+				for (hashable_type const& elem : b)
+					b2j_[elem].push_back(index++);
+
+				// Purge junk elements
+				purged_ = false;
+				if (is_junk) {
+					for (auto it = b2j_.begin(); it != b2j_.end();) {
+						if (is_junk(it->first)) {
+							it = b2j_.erase(it);
+							purged_ = true;
+						} else {
+							++it;
+						}
+					}
+				}
+
+				// Purge popular elements that are not junk
+				if (auto_junk && auto_junk_minsize <= b.size()) {
+					size_t ntest = b.size() / 100 + 1;
+					for (auto it = b2j_.begin(); it != b2j_.end();) {
+						if (ntest < it->second.size()) {
+							it = b2j_.erase(it);
+							purged_ = true;
+						} else {
+							++it;
+						}
+					}
+				}
+
+				fullbcount_.clear();
+			}
+
+			// As with the operator[] of the map, looking an element up
+			// makes contains() true for it.
+			std::vector<size_t> const& positions(hashable_type const& elem) {
+				return b2j_[elem];
+			}
+
+			bool contains(hashable_type const& elem) const {
+				return b2j_.count(elem) > 0;
+			}
+
+			// Brings contains() back to where build() left it, for the
+			// next sequence a.
+			void forget_lookups() {
+				if (!purged_) return;
+				for (auto it = b2j_.begin(); it != b2j_.end();) {
+					if (it->second.empty())
+						it = b2j_.erase(it);
+					else
+						++it;
+				}
+			}
+
+			// Size of the intersection of a and b, as multisets.
+			size_t common_elements(T const& a, T const& b) {
+				if (fullbcount_.empty()) {
+					for (hashable_type const& elem : b)
+						++fullbcount_[elem];
+				}
+
+				avail_.clear();
+				size_t matches = 0;
+				for (hashable_type const& elem : a) {
+					auto it = avail_.find(elem);
+					if (it == avail_.end()) {
+						auto const full = fullbcount_.find(elem);
+						auto const count =
+						    full == fullbcount_.end() ? 0 : full->second;
+						it = avail_.emplace(elem, count).first;
+					}
+					if (it->second > 0) {
+						--it->second;
+						++matches;
+					}
+				}
+				return matches;
+			}
+
+		private:
+			using count_t = std::unordered_map<hashable_type, size_t>;
+
+			std::unordered_map<hashable_type, std::vector<size_t>> b2j_;
+			bool purged_ = false;
+			count_t fullbcount_;
+			count_t avail_;
+		};
+
+		template <class T>
+		constexpr bool is_byte_sequence =
+		    sizeof(typename T::value_type) == 1 &&
+		    std::is_integral_v<typename T::value_type>;
+
+		// The same index for 8-bit elements: one bucket per byte value,
+		// with all the positions in a single vector, and no hashing.
+		template <class T>
+		class b2j_index<T, std::enable_if_t<is_byte_sequence<T>>> {
+		public:
+			using hashable_type = typename T::value_type;
+			using junk_function_type = bool (*)(hashable_type const&);
+
+			void build(T const& b,
+			           junk_function_type is_junk,
+			           bool auto_junk,
+			           std::size_t auto_junk_minsize) {
+				counts_.fill(0);
+				for (hashable_type const& elem : b)
+					++counts_[bucket(elem)];
+
+				auto const purge_popular =
+				    auto_junk && auto_junk_minsize <= b.size();
+				size_t ntest = b.size() / 100 + 1;
+				for (size_t value = 0; value < buckets; ++value) {
+					auto const elem = static_cast<hashable_type>(value);
+					kept_[value] = counts_[value] &&
+					               !(is_junk && is_junk(elem)) &&
+					               !(purge_popular && ntest < counts_[value]);
+				}
+
+				starts_[0] = 0;
+				for (size_t value = 0; value < buckets; ++value) {
+					starts_[value + 1] =
+					    starts_[value] + (kept_[value] ? counts_[value] : 0);
+				}
+
+				positions_.resize(starts_[buckets]);
+				auto next = starts_;
+				size_t index = 0;
+				for (hashable_type const& elem : b) {
+					auto const value = bucket(elem);
+					if (kept_[value]) positions_[next[value]++] = index;
+					++index;
+				}
+
+				known_ = kept_;
+			}
+
+			std::span<size_t const> positions(hashable_type const& elem) {
+				auto const value = bucket(elem);
+				known_[value] = true;
+				return {positions_.data() + starts_[value],
+				        positions_.data() + starts_[value + 1]};
+			}
+
+			bool contains(hashable_type const& elem) const {
+				return known_[bucket(elem)];
+			}
+
+			void forget_lookups() { known_ = kept_; }
+
+			size_t common_elements(T const& a, T const&) const {
+				auto avail = counts_;
+				size_t matches = 0;
+				for (hashable_type const& elem : a) {
+					auto& count = avail[bucket(elem)];
+					if (count > 0) {
+						--count;
+						++matches;
+					}
+				}
+				return matches;
+			}
+
+		private:
+			static constexpr size_t buckets = 256;
+
+			static size_t bucket(hashable_type elem) {
+				return static_cast<unsigned char>(elem);
+			}
+
+			std::array<size_t, buckets> counts_{};
+			std::array<size_t, buckets + 1> starts_{};
+			std::array<bool, buckets> kept_{};
+			std::array<bool, buckets> known_{};
+			std::vector<size_t> positions_;
+		};
+	}  // namespace detail
+
 	template <class T = std::string>
 	class SequenceMatcher {
 		static_assert(is_standard_iterable<T>::value,
@@ -129,7 +327,8 @@ namespace difflib {
 	public:
 		using value_type = T;
 		using hashable_type = typename T::value_type;
-		using junk_function_type = std::function<bool(hashable_type const&)>;
+		using junk_function_type =
+		    typename detail::b2j_index<T>::junk_function_type;
 
 		SequenceMatcher(T const& a,
 		                T const& b,
@@ -155,9 +354,12 @@ namespace difflib {
 			set_seq2(b);
 		}
 
+		// Keeps the index of b, so comparing many sequences with the same
+		// b only pays for it once.
 		void set_seq1(T const& a) {
 			a_ = a;
-			matching_blocks_ = nullptr;
+			b2j_.forget_lookups();
+			has_matching_blocks_ = false;
 			opcodes_ = nullptr;
 		}
 
@@ -165,17 +367,26 @@ namespace difflib {
 			b_ = b;
 			j2len_.resize(b.size() + 1);
 			chain_b();
-			matching_blocks_ = nullptr;
+			has_matching_blocks_ = false;
 			opcodes_ = nullptr;
 		}
 
 		double ratio() {
 			size_t sum = 0;
-			size_t length = a_.size() + b_.size();
-			if (length == 0) return 1.0;
 			for (match_t m : get_matching_blocks())
 				sum += std::get<2>(m);
-			return 2. * sum / length;
+			return calculate_ratio(sum);
+		}
+
+		// Upper bound on ratio(), counting the elements both sequences
+		// have, regardless of their order.
+		double quick_ratio() {
+			return calculate_ratio(b2j_.common_elements(a_, b_));
+		}
+
+		// Upper bound on ratio() and quick_ratio(), from the lengths alone.
+		double real_quick_ratio() const {
+			return calculate_ratio((std::min)(a_.size(), b_.size()));
 		}
 
 		match_t find_longest_match(size_t a_low,
@@ -195,7 +406,7 @@ namespace difflib {
 				for (size_t i = a_low; i < a_high; ++i) {
 					j2_values_to_affect_.clear();
 
-					for (size_t j : b2j_[a_[i]]) {
+					for (size_t j : b2j_.positions(a_[i])) {
 						if (j < b_low) continue;
 						if (j >= b_high) break;
 						size_t k = j2len_[j] + 1;
@@ -225,7 +436,7 @@ namespace difflib {
 			                         this](bool isjunk) {
 				while (best_i > a_low && best_j > b_low &&
 				       this->a_[best_i - 1] == this->b_[best_j - 1] &&
-				       isjunk == (b2j_.count(b_[best_j - 1]) > 0)) {
+				       isjunk == b2j_.contains(b_[best_j - 1])) {
 					--best_i;
 					--best_j;
 					++best_size;
@@ -240,7 +451,7 @@ namespace difflib {
 				       (best_j + best_size) < b_high &&
 				       this->a_[best_i + best_size] ==
 				           this->b_[best_j + best_size] &&
-				       isjunk == (b2j_.count(b_[best_j + best_size]) > 0)) {
+				       isjunk == b2j_.contains(b_[best_j + best_size])) {
 					++best_size;
 				}
 			};
@@ -256,14 +467,16 @@ namespace difflib {
 			return make_tuple(best_i, best_j, best_size);
 		}
 
-		match_list_t get_matching_blocks() {
+		match_list_t const& get_matching_blocks() {
 			// The following are tuple extracting aliases
 			using std::get;
 
-			if (matching_blocks_) return *matching_blocks_;
+			if (has_matching_blocks_) return matching_blocks_;
 
-			vector<tuple<size_t, size_t, size_t, size_t>> queue;
-			vector<match_t> matching_blocks_pass1;
+			auto& queue = queue_;
+			auto& matching_blocks_pass1 = matching_blocks_pass1_;
+			queue.clear();
+			matching_blocks_pass1.clear();
 
 			std::size_t queue_head = 0;
 			queue.reserve((std::min)(a_.size(), b_.size()));
@@ -288,8 +501,8 @@ namespace difflib {
 			std::sort(std::begin(matching_blocks_pass1),
 			          end(matching_blocks_pass1));
 
-			matching_blocks_.reset(new match_list_t);
-			matching_blocks_->reserve(matching_blocks_pass1.size());
+			matching_blocks_.clear();
+			matching_blocks_.reserve(matching_blocks_pass1.size());
 
 			size_t i1, j1, k1;
 			i1 = j1 = k1 = 0;
@@ -298,14 +511,15 @@ namespace difflib {
 				if (i1 + k1 == get<0>(m) && j1 + k1 == get<1>(m)) {
 					k1 += get<2>(m);
 				} else {
-					if (k1) matching_blocks_->emplace_back(i1, j1, k1);
+					if (k1) matching_blocks_.emplace_back(i1, j1, k1);
 					std::tie(i1, j1, k1) = m;
 				}
 			}
-			if (k1) matching_blocks_->emplace_back(i1, j1, k1);
-			matching_blocks_->emplace_back(a_.size(), b_.size(), 0);
+			if (k1) matching_blocks_.emplace_back(i1, j1, k1);
+			matching_blocks_.emplace_back(a_.size(), b_.size(), 0);
+			has_matching_blocks_ = true;
 
-			return *matching_blocks_;
+			return matching_blocks_;
 		}
 
 		/*!
@@ -391,59 +605,33 @@ namespace difflib {
 		T a_;
 		T b_;
 		junk_function_type is_junk_ = nullptr;
-		std::unique_ptr<match_list_t> matching_blocks_;
+		match_list_t matching_blocks_;
+		bool has_matching_blocks_ = false;
 		std::unique_ptr<chunk_list_t> opcodes_;
 
 	private:
-		using b2j_t = std::unordered_map<hashable_type, std::vector<size_t>>;
-		using junk_set_t = std::unordered_set<hashable_type>;
+		// The same arithmetic for all three ratios, so a bound is never
+		// below the ratio by a rounding error.
+		double calculate_ratio(size_t matches) const {
+			size_t length = a_.size() + b_.size();
+			if (length == 0) return 1.0;
+			return 2. * matches / length;
+		}
 
 		void chain_b() {
-			size_t index = 0;
-
-			// Counting occurences
-			b2j_.clear();
-			for (hashable_type const& elem : b_)
-				b2j_[elem].push_back(index++);
-
-			// Purge junk elements
-			junk_set_.clear();
-			if (is_junk_) {
-				for (auto it = b2j_.begin(); it != b2j_.end();) {
-					if (is_junk_(it->first)) {
-						junk_set_.insert(it->first);
-						it = b2j_.erase(it);
-					} else {
-						++it;
-					}
-				}
-			}
-
-			// Purge popular elements that are not junk
-			popular_set_.clear();
-			if (auto_junk_ && auto_junk_minsize_ <= b_.size()) {
-				size_t ntest = b_.size() / 100 + 1;
-				for (auto it = b2j_.begin(); it != b2j_.end();) {
-					if (ntest < it->second.size()) {
-						popular_set_.insert(it->first);
-						it = b2j_.erase(it);
-					} else {
-						++it;
-					}
-				}
-			}
+			b2j_.build(b_, is_junk_, auto_junk_, auto_junk_minsize_);
 		}
 
 		bool auto_junk_ = true;
 		std::size_t auto_junk_minsize_ = 200u;
-		b2j_t b2j_;
-		junk_set_t junk_set_;
-		junk_set_t popular_set_;
+		detail::b2j_index<T> b2j_;
 
 		// Cache to avoid reallocations
 		std::vector<size_t> j2len_;
 		std::vector<std::pair<size_t, size_t>> j2_values_to_affect_;
 		std::vector<std::pair<size_t, size_t>> j2_values_to_erase_;
+		vector<tuple<size_t, size_t, size_t, size_t>> queue_;
+		vector<match_t> matching_blocks_pass1_;
 	};
 
 	template <class T>
@@ -0,0 +1,223 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <movies/movie_info.hpp>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "difflib.hpp"
+#include "normalize.hpp"
+#include "similarity.hpp"
+
+// Building blocks of the fuzzy matching, shared by the differ and the
+// title_index, so both of them see the library the same way.
+
+namespace movies::fuzzy {
+	using matcher = difflib::SequenceMatcher<std::u8string_view>;
+
+	// The normalization of the ids and of the video names.
+	inline void spaced(std::span<char8_t> key) {
+		normalize::to_spaces(key, u8"-_");
+	}
+
+	// The normalization of the titles.
+	inline void lowercased(std::span<char8_t> key) {
+		normalize::lowercase(key);
+	}
+
+	// Calls add(text, normalization) for the id and for all the titles
+	// of an info, in this order.
+	template <typename Add>
+	void for_each_key(std::u8string_view id, movie_info const& mv, Add&& add) {
+		add(id, spaced);
+		for (auto const& [_, title] : mv.title.items) {
+			add(as_utf8_view(title.text), lowercased);
+		}
+	}
+
+	// The matching blocks of the SequenceMatcher are common to both
+	// strings, in the same order, and two neighbouring blocks are always
+	// separated by at least one unmatched byte. With M bytes matched in k
+	// blocks, the strings share at least M - k byte pairs and k - 1 is no
+	// more than the T - 2M unmatched bytes (T being the total length of
+	// both strings). As ratio() >= r needs M >= r T / 2, such a pair of
+	// strings must share at least (3r / 2 - 1) T - 1 byte pairs (0.2 T - 1
+	// for the differ); the ones which do not, cannot pass the threshold.
+	inline double pair_factor(double min_ratio) noexcept {
+		return 1.5 * min_ratio - 1.0;
+	}
+
+	// With r of 2/3 or less, any pair may.
+	inline bool has_pair_bound(double min_ratio) noexcept {
+		return pair_factor(min_ratio) > 0;
+	}
+
+	inline bool may_be_similar(std::size_t common_pairs,
+	                           std::size_t total_length,
+	                           double min_ratio) noexcept {
+		auto const factor = pair_factor(min_ratio);
+		if (factor <= 0) return true;
+		// a little slack for the rounding of the factor
+		return static_cast<double>(common_pairs + 1) >=
+		       factor * static_cast<double>(total_length) * (1 - 1e-9);
+	}
+
+	using byte_pair = std::uint16_t;
+	using pair_bag = std::vector<std::pair<byte_pair, std::uint32_t>>;
+
+	inline pair_bag bag_of(std::u8string_view text) {
+		std::vector<byte_pair> pairs{};
+		if (text.size() > 1) pairs.reserve(text.size() - 1);
+		for (size_t index = 1; index < text.size(); ++index) {
+			pairs.push_back(static_cast<byte_pair>(
+			    (static_cast<unsigned>(text[index - 1]) << 8) |
+			    static_cast<unsigned>(text[index])));
+		}
+		std::sort(pairs.begin(), pairs.end());
+
+		pair_bag result{};
+		for (auto const pair : pairs) {
+			if (!result.empty() && result.back().first == pair)
+				++result.back().second;
+			else
+				result.push_back({pair, 1});
+		}
+		return result;
+	}
+
+	// Inverted index from the byte pairs to the strings, which contain
+	// them. Every string belongs to an owner (an info of the differ, an
+	// entry of the title_index); a query names the owners with at least
+	// one string, which may_be_similar() to the key, as every other owner
+	// is known to stay below the threshold.
+	//
+	// Strings are only ever added; the owners, which are gone, are to be
+	// skipped by the caller, until the whole index is cleared and built
+	// again. Nothing changes in a const index, so it can be queried from
+	// many threads, each with its own query.
+	class posting_index {
+	public:
+		void add(std::size_t owner, std::u8string_view text) {
+			auto const string = strings_.size();
+			strings_.push_back({owner, text.size()});
+			owners_ = (std::max)(owners_, owner + 1);
+			by_length_[text.size()].push_back(string);
+			for (auto const& [pair, count] : bag_of(text))
+				postings_[pair].push_back({string, count});
+		}
+
+		void clear() {
+			owners_ = 0;
+			strings_.clear();
+			by_length_.clear();
+			postings_.clear();
+		}
+
+		std::size_t strings() const noexcept { return strings_.size(); }
+
+		// Scratch space of one caller, sized to the largest index it has
+		// seen; everything in it is back to zero between the calls, so it
+		// can be reused with any index, and with no allocation, once it
+		// has grown.
+		class query {
+		public:
+			// The owners in the ascending order; valid until the next call.
+			std::vector<std::size_t> const& candidates(
+			    posting_index const& index,
+			    std::u8string_view key,
+			    double min_ratio) {
+				result_.clear();
+				if (owner_seen_.size() < index.owners_)
+					owner_seen_.resize(index.owners_);
+
+				if (!has_pair_bound(min_ratio)) {
+					for (std::size_t owner = 0; owner < index.owners_; ++owner)
+						result_.push_back(owner);
+					return result_;
+				}
+
+				if (common_.size() < index.strings_.size())
+					common_.resize(index.strings_.size());
+				touched_.clear();
+
+				auto const& strings = index.strings_;
+				for (auto const& [pair, count] : bag_of(key)) {
+					auto it = index.postings_.find(pair);
+					if (it == index.postings_.end()) continue;
+					for (auto const& [string, in_string] : it->second) {
+						if (!common_[string]) touched_.push_back(string);
+						common_[string] += (std::min)(count, in_string);
+					}
+				}
+
+				for (auto const string : touched_) {
+					if (may_be_similar(common_[string],
+					                   strings[string].length + key.size(),
+					                   min_ratio))
+						add_owner(strings[string].owner);
+					common_[string] = 0;
+				}
+
+				// strings short enough to pass with no common pairs
+				for (auto const& [length, short_strings] : index.by_length_) {
+					if (!may_be_similar(0, length + key.size(), min_ratio))
+						break;
+					for (auto const string : short_strings)
+						add_owner(strings[string].owner);
+				}
+
+				for (auto const owner : result_)
+					owner_seen_[owner] = false;
+				std::sort(result_.begin(), result_.end());
+				return result_;
+			}
+
+		private:
+			void add_owner(std::size_t owner) {
+				if (owner_seen_[owner]) return;
+				owner_seen_[owner] = true;
+				result_.push_back(owner);
+			}
+
+			std::vector<std::uint32_t> common_{};
+			std::vector<std::size_t> touched_{};
+			std::vector<bool> owner_seen_{};
+			std::vector<std::size_t> result_{};
+		};
+
+	private:
+		struct indexed_string {
+			std::size_t owner;
+			std::size_t length;
+		};
+
+		std::size_t owners_{};
+		std::vector<indexed_string> strings_{};
+		std::map<std::size_t, std::vector<std::size_t>> by_length_{};
+		std::unordered_map<byte_pair,
+		                   std::vector<std::pair<std::size_t, std::uint32_t>>>
+		    postings_{};
+	};
+
+	// Upper bound of any ratio, from the lengths alone (difflib's
+	// real_quick_ratio()).
+	inline double length_bound(std::u8string_view text,
+	                           std::u8string_view key) noexcept {
+		return similarity::ratio_of((std::min)(text.size(), key.size()),
+		                            text.size() + key.size());
+	}
+
+	// The numerator of ratio().
+	inline size_t matches_of(matcher& similar) {
+		size_t result = 0;
+		for (auto const& block : similar.get_matching_blocks())
+			result += std::get<2>(block);
+		return result;
+	}
+}  // namespace movies::fuzzy
@@ -0,0 +1,98 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#include <algorithm>
+#include <movies/fuzzy_cache.hpp>
+#include <vector>
+
+namespace movies {
+	using namespace std::literals;
+
+	namespace {
+		static constexpr auto CACHE_VERSION = 1ll;
+
+		long long as_json(std::uint64_t value) {
+			return static_cast<long long>(value);
+		}
+
+		std::uint64_t from_json_number(long long value) {
+			return static_cast<std::uint64_t>(value);
+		}
+	}  // namespace
+
+	void fuzzy_cache::evict() {
+		if (scores.size() <= capacity) return;
+
+		std::vector<std::pair<std::uint64_t, key>> by_age{};
+		by_age.reserve(scores.size());
+		for (auto const& [k, entry] : scores)
+			by_age.push_back({entry.generation, k});
+
+		auto const excess = scores.size() - capacity;
+		std::nth_element(
+		    by_age.begin(), by_age.begin() + (excess - 1), by_age.end(),
+		    [](auto const& lhs, auto const& rhs) {
+			    return lhs.first < rhs.first;
+		    });
+		for (size_t index = 0; index < excess; ++index)
+			scores.erase(by_age[index].second);
+	}
+
+	json::node fuzzy_cache::to_json() const {
+		json::array json_scores{};
+		json_scores.reserve(scores.size());
+		for (auto const& [k, entry] : scores) {
+			json::array item{as_json(k.info), as_json(k.video),
+			                 as_json(entry.generation)};
+			if (entry.close) {
+				item.push_back(static_cast<long long>(entry.matches));
+				item.push_back(static_cast<long long>(entry.length));
+			}
+			json_scores.push_back(std::move(item));
+		}
+
+		json::map result{};
+		result[u8"version"s] = CACHE_VERSION;
+		result[u8"generation"s] = as_json(generation);
+		result[u8"scores"s] = std::move(json_scores);
+		return result;
+	}
+
+	void fuzzy_cache::from_json(json::node const& node) {
+		generation = 0;
+		scores.clear();
+
+		auto version = cast<long long>(node, u8"version"s);
+		auto json_generation = cast<long long>(node, u8"generation"s);
+		auto json_scores = cast<json::array>(node, u8"scores"s);
+		if (!version || *version != CACHE_VERSION || !json_generation ||
+		    !json_scores)
+			return;
+
+		generation = from_json_number(*json_generation);
+		for (auto const& json_item : *json_scores) {
+			auto item = cast<json::array>(json_item);
+			if (!item || (item->size() != 3 && item->size() != 5)) continue;
+
+			long long numbers[5]{};
+			auto valid = true;
+			for (size_t index = 0; index < item->size(); ++index) {
+				auto number = cast<long long>((*item)[index]);
+				if (!number) {
+					valid = false;
+					break;
+				}
+				numbers[index] = *number;
+			}
+			if (!valid) continue;
+
+			score entry{.close = item->size() == 5,
+			            .matches = static_cast<std::uint32_t>(numbers[3]),
+			            .length = static_cast<std::uint32_t>(numbers[4]),
+			            .generation = from_json_number(numbers[2])};
+			if (entry.close && entry.matches > entry.length) continue;
+			scores[{from_json_number(numbers[0]),
+			        from_json_number(numbers[1])}] = entry;
+		}
+	}
+}  // namespace movies
@@ -0,0 +1,90 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#include <array>
+#include <memory>
+#include <movies/binary.hpp>
+#include <movies/interned.hpp>
+#include <mutex>
+#include <unordered_map>
+
+namespace movies {
+	namespace {
+		class string_pool {
+		public:
+			std::u8string const* intern(std::u8string_view value) {
+				if (value.empty()) return &empty_;
+
+				auto const hash = std::hash<std::u8string_view>{}(value);
+				auto& shard = shards_[hash % shards_.size()];
+				std::lock_guard lock{shard.mutex};
+
+				auto it = shard.values.find(value);
+				if (it != shard.values.end()) return it->second.get();
+
+				// the key views the value it maps to, which never moves
+				auto copy = std::make_unique<std::u8string const>(value);
+				auto const result = copy.get();
+				shard.values.emplace(std::u8string_view{*result},
+				                     std::move(copy));
+				return result;
+			}
+
+			std::size_t size() {
+				std::size_t result = 1;
+				for (auto& shard : shards_) {
+					std::lock_guard lock{shard.mutex};
+					result += shard.values.size();
+				}
+				return result;
+			}
+
+			static string_pool& instance() {
+				static string_pool pool{};
+				return pool;
+			}
+
+		private:
+			struct shard {
+				std::mutex mutex{};
+				std::unordered_map<std::u8string_view,
+				                   std::unique_ptr<std::u8string const>>
+				    values{};
+			};
+
+			// the loader interns from many threads at once
+			std::array<shard, 16> shards_{};
+			std::u8string const empty_{};
+		};
+	}  // namespace
+
+	interned_string::interned_string() noexcept
+	    : value_{string_pool::instance().intern({})} {}
+
+	interned_string::interned_string(std::u8string_view value)
+	    : value_{string_pool::instance().intern(value)} {}
+
+	void interned_string::to_binary(binary_writer& out) const {
+		movies::to_binary(out, *value_);
+	}
+
+	bool interned_string::from_binary(binary_reader& in) {
+		size_t size{};
+		std::span<char8_t const> view{};
+		if (!in.read_size(size) || !in.read_view(size, view)) return false;
+		value_ = string_pool::instance().intern({view.data(), view.size()});
+		return true;
+	}
+
+	void language_key::to_binary(binary_writer& out) const {
+		value_.to_binary(out);
+	}
+
+	bool language_key::from_binary(binary_reader& in) {
+		return value_.from_binary(in);
+	}
+
+	std::size_t interned_string::pool_size() {
+		return string_pool::instance().size();
+	}
+}  // namespace movies
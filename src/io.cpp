@@ -2,6 +2,18 @@
 // This code is licensed under MIT license (see LICENSE for details)
 
 #include <io/file.hpp>
+#include <system_error>
+#include <utility>
+
+#ifdef WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace io {
 	file::ptr file::open(fs::path const& filename, char const* mode) {
@@ -38,4 +50,143 @@ namespace io {
 
 		return result;
 	}
+
+	bool replace_contents(fs::path const& filename,
+	                      std::span<char8_t const> bytes) {
+		auto tmp_name = filename;
+		tmp_name += ".tmp";
+
+		auto written = false;
+		if (auto file = file::open(tmp_name, "wb")) {
+			written = std::fwrite(bytes.data(), 1, bytes.size(),
+			                      file.get()) == bytes.size();
+			// a full disk may only show up, when the buffer is flushed
+			written = std::fclose(file.release()) == 0 && written;
+		}
+
+		std::error_code ec{};
+		if (written) fs::rename(tmp_name, filename, ec);
+		if (!written || ec) {
+			fs::remove(tmp_name, ec);
+			return false;
+		}
+		return true;
+	}
+
+	namespace {
+#ifdef WIN32
+		struct handle_closer {
+			void operator()(HANDLE ptr) { ::CloseHandle(ptr); }
+		};
+		using handle_ptr = std::unique_ptr<void, handle_closer>;
+
+		void const* map_file(fs::path const& filename, size_t& size) {
+			handle_ptr file{::CreateFileW(
+			    filename.native().c_str(), GENERIC_READ, FILE_SHARE_READ,
+			    nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr)};
+			if (file.get() == INVALID_HANDLE_VALUE) {
+				file.release();
+				return nullptr;
+			}
+
+			LARGE_INTEGER length{};
+			if (!::GetFileSizeEx(file.get(), &length) || length.QuadPart <= 0 ||
+			    ::GetFileType(file.get()) != FILE_TYPE_DISK)
+				return nullptr;
+
+			handle_ptr mapping{::CreateFileMappingW(
+			    file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr)};
+			if (!mapping) return nullptr;
+
+			auto const ptr =
+			    ::MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, 0);
+			if (ptr) size = static_cast<size_t>(length.QuadPart);
+			return ptr;
+		}
+
+		void unmap_file(void const* ptr, size_t) {
+			::UnmapViewOfFile(ptr);
+		}
+#else
+		void const* map_file(fs::path const& filename, size_t& size) {
+			auto const fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+			if (fd < 0) return nullptr;
+
+			void* ptr = nullptr;
+			struct stat st {};
+			if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) &&
+			    st.st_size > 0) {
+				auto const length = static_cast<size_t>(st.st_size);
+				ptr = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (ptr == MAP_FAILED) {
+					ptr = nullptr;
+				} else {
+					::madvise(ptr, length, MADV_SEQUENTIAL);
+					size = length;
+				}
+			}
+
+			::close(fd);
+			return ptr;
+		}
+
+		void unmap_file(void const* ptr, size_t size) {
+			::munmap(const_cast<void*>(ptr), size);
+		}
+#endif
+	}  // namespace
+
+	mapped_file::~mapped_file() { reset(); }
+
+	mapped_file::mapped_file(mapped_file&& other) noexcept
+	    : data_{std::exchange(other.data_, nullptr)}
+	    , size_{std::exchange(other.size_, 0)}
+	    , mapped_{std::exchange(other.mapped_, false)}
+	    , opened_{std::exchange(other.opened_, false)}
+	    , buffer_{std::move(other.buffer_)} {}
+
+	mapped_file& mapped_file::operator=(mapped_file&& other) noexcept {
+		if (this != &other) {
+			reset();
+			data_ = std::exchange(other.data_, nullptr);
+			size_ = std::exchange(other.size_, 0);
+			mapped_ = std::exchange(other.mapped_, false);
+			opened_ = std::exchange(other.opened_, false);
+			buffer_ = std::move(other.buffer_);
+		}
+		return *this;
+	}
+
+	void mapped_file::reset() noexcept {
+		if (mapped_) unmap_file(data_, size_);
+		data_ = nullptr;
+		size_ = 0;
+		mapped_ = false;
+		opened_ = false;
+		buffer_.clear();
+	}
+
+	mapped_file mapped_file::open(fs::path const& filename) {
+		mapped_file result{};
+
+		size_t size{};
+		if (auto const ptr = map_file(filename, size)) {
+			result.data_ = static_cast<char8_t const*>(ptr);
+			result.size_ = size;
+			result.mapped_ = true;
+			result.opened_ = true;
+			return result;
+		}
+
+		// Either the file is not there, or it is something we should not
+		// (or could not) map; let stdio decide and read it the old way.
+		auto fallback = file::open(filename, "rb");
+		if (!fallback) return result;
+
+		result.buffer_ = contents(fallback);
+		result.data_ = result.buffer_.data();
+		result.size_ = result.buffer_.size();
+		result.opened_ = true;
+		return result;
+	}
 }  // namespace io
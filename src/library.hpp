@@ -0,0 +1,88 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <movies/load_stats.hpp>
+#include <movies/manifest.hpp>
+#include <movies/movie_info.hpp>
+
+// Building blocks of movies_config::load(), shared with library_watch.
+
+namespace movies {
+	// What the directory walk has seen, so building the file_refs later
+	// does not need to go back to the disk.
+	struct seen_file {
+		fs_string extension{};
+		file_stat stat{};
+	};
+	using seen_files = map<fs_string, seen_file>;
+
+	file_ref info_ref(movies_dirs const& dirs, fs_string const& id);
+	file_ref video_ref(movies_dirs const& dirs, fs_string const& id);
+	// Fall back to the overloads above for ids, which were not seen.
+	file_ref info_ref(movies_dirs const& dirs,
+	                  fs_string const& id,
+	                  seen_files const& seen);
+	file_ref video_ref(movies_dirs const& dirs,
+	                   fs_string const& id,
+	                   seen_files const& seen);
+
+	// Raised by another thread to cut a load short. The loader looks at
+	// it between the files of the walks, the infos of the parsers and the
+	// videos of the differ, and throws load_stopped once it is seen.
+	using stop_flag = std::atomic<bool>;
+	struct load_stopped {};
+
+	inline void throw_if_stopped(stop_flag const* stop) {
+		if (stop && stop->load(std::memory_order_relaxed)) throw load_stopped{};
+	}
+
+	// Called for every info as soon as it is parsed (or taken from the
+	// manifest); with more than one job, from many threads at once.
+	using parsed_callback = std::function<
+	    void(fs_string const& id, movie_info const& info, file_stat const&)>;
+
+	// With a partial set of fields, neither the updates nor the manifest
+	// are touched, as the infos are not complete.
+	map<fs_string, movie_info> known_movies(
+	    movies_dirs const& dirs,
+	    bool store_updates,
+	    unsigned jobs,
+	    library_manifest* manifest,
+	    seen_files* seen = nullptr,
+	    parsed_callback const* on_parsed = nullptr,
+	    movie_info_fields fields = movie_info_fields::all,
+	    load_stats* stats = nullptr,
+	    stop_flag const* stop = nullptr);
+	// With two videos for the same id, the .mp4 one is seen.
+	vector<fs_string> downloaded_movies(movies_dirs const& dirs,
+	                                    seen_files* seen = nullptr,
+	                                    stop_flag const* stop = nullptr);
+
+	// Moves the ids present on both lists to the result, leaving only the
+	// unmatched ones behind.
+	vector<fs_string> split_simple(vector<fs_string>& infos,
+	                               vector<fs_string>& videos);
+
+	loaded_movie make_empty(std::optional<file_ref> const& video_file,
+	                        std::optional<file_ref> const& info_file);
+
+	using movie_sink = std::function<void(loaded_movie&&)>;
+
+	// Hands the movies to the sink in the order of load(): exact matches,
+	// fuzzy matches, orphaned videos, orphaned infos. With early_exact, the
+	// exact matches are handed over while the infos are still parsed, in
+	// no particular order and possibly from many threads at once. The
+	// title is always loaded, as the fuzzy matches need it.
+	void stream_library(movies_config const& cfg,
+	                    bool store_updates,
+	                    library_manifest* manifest,
+	                    movie_sink const& sink,
+	                    bool early_exact,
+	                    movie_info_fields fields,
+	                    load_stats* stats = nullptr,
+	                    stop_flag const* stop = nullptr);
+}  // namespace movies
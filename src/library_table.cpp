@@ -0,0 +1,313 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#include <bit>
+#include <movies/library_table.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MOVIES_TABLE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace movies {
+	namespace {
+		constexpr std::size_t word_bits = 64;
+
+		constexpr std::size_t words_for(std::size_t rows) noexcept {
+			return (rows + word_bits - 1) / word_bits;
+		}
+
+		std::uint32_t number_of(std::optional<unsigned> const& value) {
+			if (!value || *value >= library_table::no_number)
+				return library_table::no_number;
+			return static_cast<std::uint32_t>(*value);
+		}
+
+		std::int64_t date_of(std::optional<date::sys_seconds> const& value) {
+			if (!value) return library_table::no_date;
+			return value->time_since_epoch().count();
+		}
+
+		// Bits of the rows [first, first + 64) with min <= value <= max;
+		// the rows past the end of the column are left out.
+		std::uint64_t between_word(std::span<std::uint32_t const> values,
+		                           std::size_t first,
+		                           std::uint32_t min,
+		                           std::uint32_t max) noexcept {
+			auto const last = (std::min)(first + word_bits, values.size());
+			std::uint64_t word{};
+			auto row = first;
+#if defined(MOVIES_TABLE_SSE2)
+			// SSE2 has no unsigned compares; with the sign bits flipped,
+			// the signed ones give the same answer
+			auto const sign = _mm_set1_epi32(static_cast<int>(0x80000000u));
+			auto const low = _mm_xor_si128(
+			    _mm_set1_epi32(static_cast<int>(min)), sign);
+			auto const high = _mm_xor_si128(
+			    _mm_set1_epi32(static_cast<int>(max)), sign);
+			for (; row + 4 <= last; row += 4) {
+				auto const block = _mm_xor_si128(
+				    _mm_loadu_si128(
+				        reinterpret_cast<__m128i const*>(values.data() + row)),
+				    sign);
+				auto const outside =
+				    _mm_or_si128(_mm_cmpgt_epi32(low, block),
+				                 _mm_cmpgt_epi32(block, high));
+				auto const inside = static_cast<std::uint64_t>(
+				    ~_mm_movemask_ps(_mm_castsi128_ps(outside)) & 0xF);
+				word |= inside << (row - first);
+			}
+#endif
+			for (; row < last; ++row) {
+				auto const value = values[row];
+				if (value >= min && value <= max)
+					word |= std::uint64_t{1} << (row - first);
+			}
+			return word;
+		}
+
+		std::uint64_t equal_word(std::span<std::uint8_t const> values,
+		                         std::size_t first,
+		                         std::uint8_t expected) noexcept {
+			auto const last = (std::min)(first + word_bits, values.size());
+			std::uint64_t word{};
+			auto row = first;
+#if defined(MOVIES_TABLE_SSE2)
+			auto const pattern = _mm_set1_epi8(static_cast<char>(expected));
+			for (; row + 16 <= last; row += 16) {
+				auto const block = _mm_loadu_si128(
+				    reinterpret_cast<__m128i const*>(values.data() + row));
+				auto const equal = static_cast<std::uint64_t>(
+				    static_cast<unsigned>(_mm_movemask_epi8(
+				        _mm_cmpeq_epi8(block, pattern))));
+				word |= equal << (row - first);
+			}
+#endif
+			for (; row < last; ++row) {
+				if (values[row] == expected)
+					word |= std::uint64_t{1} << (row - first);
+			}
+			return word;
+		}
+	}  // namespace
+
+	row_set::row_set(std::size_t rows, bool value)
+	    : rows_{rows}, words_(words_for(rows), value ? ~std::uint64_t{} : 0) {
+		clear_tail();
+	}
+
+	std::size_t row_set::count() const noexcept {
+		std::size_t result{};
+		for (auto const word : words_)
+			result += static_cast<std::size_t>(std::popcount(word));
+		return result;
+	}
+
+	bool row_set::contains(std::size_t row) const noexcept {
+		if (row >= rows_) return false;
+		return (words_[row / word_bits] >> (row % word_bits)) & 1;
+	}
+
+	void row_set::insert(std::size_t row) noexcept {
+		if (row >= rows_) return;
+		words_[row / word_bits] |= std::uint64_t{1} << (row % word_bits);
+	}
+
+	std::vector<std::size_t> row_set::indices() const {
+		std::vector<std::size_t> result{};
+		result.reserve(count());
+		for (std::size_t index = 0; index < words_.size(); ++index) {
+			auto word = words_[index];
+			while (word) {
+				auto const bit = std::countr_zero(word);
+				result.push_back(index * word_bits +
+				                 static_cast<std::size_t>(bit));
+				word &= word - 1;
+			}
+		}
+		return result;
+	}
+
+	row_set& row_set::operator&=(row_set const& rhs) noexcept {
+		auto const common = (std::min)(words_.size(), rhs.words_.size());
+		for (std::size_t index = 0; index < common; ++index)
+			words_[index] &= rhs.words_[index];
+		for (std::size_t index = common; index < words_.size(); ++index)
+			words_[index] = 0;
+		return *this;
+	}
+
+	row_set& row_set::operator|=(row_set const& rhs) noexcept {
+		auto const common = (std::min)(words_.size(), rhs.words_.size());
+		for (std::size_t index = 0; index < common; ++index)
+			words_[index] |= rhs.words_[index];
+		clear_tail();
+		return *this;
+	}
+
+	row_set row_set::operator~() const {
+		auto result = *this;
+		for (auto& word : result.words_)
+			word = ~word;
+		result.clear_tail();
+		return result;
+	}
+
+	void row_set::clear_tail() noexcept {
+		auto const used = rows_ % word_bits;
+		if (used && !words_.empty())
+			words_.back() &= (std::uint64_t{1} << used) - 1;
+	}
+
+	std::optional<std::uint32_t> library_table::dictionary::code_of(
+	    string_type const& value) const noexcept {
+		auto it = lookup_.find(value);
+		if (it == lookup_.end()) return std::nullopt;
+		return it->second;
+	}
+
+	void library_table::dictionary::append(
+	    std::vector<interned_string> const& items) {
+		auto const row = static_cast<std::uint32_t>(offsets.size() - 1);
+		for (auto const& item : items) {
+			auto [it, inserted] = interned_.try_emplace(
+			    item, static_cast<std::uint32_t>(values.size()));
+			if (inserted) {
+				values.push_back(item.str());
+				// the pool keeps the item alive for the view
+				lookup_.emplace(string_view_type{item}, it->second);
+			}
+			codes.push_back(it->second);
+			rows.push_back(row);
+		}
+		offsets.push_back(static_cast<std::uint32_t>(codes.size()));
+	}
+
+	library_table::library_table(std::vector<loaded_movie> const& movies) {
+		ids_.reserve(movies.size());
+		for (auto& column : numbers_)
+			column.reserve(movies.size());
+		for (auto& column : dates_)
+			column.reserve(movies.size());
+		media_types_.reserve(movies.size());
+		for (auto const& movie : movies)
+			append(movie);
+	}
+
+	void library_table::append(loaded_movie const& movie) {
+		using enum number_column;
+		using enum date_column;
+		using enum list_column;
+
+		ids_.push_back(movie.get_id());
+
+		numbers_[static_cast<size_t>(year)].push_back(number_of(movie.year));
+		numbers_[static_cast<size_t>(runtime)].push_back(
+		    number_of(movie.runtime));
+		numbers_[static_cast<size_t>(rating)].push_back(
+		    number_of(movie.rating));
+		numbers_[static_cast<size_t>(season_no)].push_back(
+		    number_of(movie.season_no));
+		numbers_[static_cast<size_t>(episode_no)].push_back(
+		    number_of(movie.episode_no));
+
+		dates_[static_cast<size_t>(published)].push_back(
+		    date_of(movie.dates.published));
+		dates_[static_cast<size_t>(stream)].push_back(
+		    date_of(movie.dates.stream));
+		dates_[static_cast<size_t>(poster)].push_back(
+		    date_of(movie.dates.poster));
+
+		media_types_.push_back(static_cast<std::uint8_t>(movie.media_type));
+
+		lists_[static_cast<size_t>(genres)].append(movie.genres);
+		lists_[static_cast<size_t>(countries)].append(movie.countries);
+		lists_[static_cast<size_t>(tags)].append(movie.tags);
+	}
+
+	std::span<std::uint32_t const> library_table::column(
+	    number_column which) const noexcept {
+		return numbers_[static_cast<size_t>(which)];
+	}
+
+	std::span<std::int64_t const> library_table::column(
+	    date_column which) const noexcept {
+		return dates_[static_cast<size_t>(which)];
+	}
+
+	library_table::dictionary const& library_table::column(
+	    list_column which) const noexcept {
+		return lists_[static_cast<size_t>(which)];
+	}
+
+	row_set library_table::between(number_column which,
+	                               std::uint32_t min,
+	                               std::uint32_t max) const {
+		row_set result{size(), false};
+		// the sentinel is above any real value
+		max = (std::min)(max, no_number - 1);
+		if (min > max) return result;
+
+		auto const values = column(which);
+		auto words = result.words();
+		for (std::size_t index = 0; index < words.size(); ++index)
+			words[index] = between_word(values, index * word_bits, min, max);
+		return result;
+	}
+
+	row_set library_table::between(date_column which,
+	                               date::sys_seconds from,
+	                               date::sys_seconds to) const {
+		row_set result{size(), false};
+		auto const low = (std::max)(from.time_since_epoch().count(),
+		                            static_cast<std::int64_t>(no_date + 1));
+		auto const high = to.time_since_epoch().count();
+
+		auto const values = column(which);
+		for (std::size_t row = 0; row < values.size(); ++row) {
+			if (values[row] >= low && values[row] <= high) result.insert(row);
+		}
+		return result;
+	}
+
+	row_set library_table::is(media_kind kind) const {
+		row_set result{size(), false};
+		auto const expected = static_cast<std::uint8_t>(kind);
+		auto words = result.words();
+		for (std::size_t index = 0; index < words.size(); ++index)
+			words[index] =
+			    equal_word(media_types_, index * word_bits, expected);
+		return result;
+	}
+
+	row_set library_table::has(list_column which,
+	                           string_type const& value) const {
+		row_set result{size(), false};
+		auto const& list = column(which);
+		auto const code = list.code_of(value);
+		if (!code) return result;
+
+		auto const codes = std::span{list.codes};
+		std::size_t index = 0;
+#if defined(MOVIES_TABLE_SSE2)
+		// most of the blocks have no match at all
+		auto const pattern = _mm_set1_epi32(static_cast<int>(*code));
+		for (; index + 4 <= codes.size(); index += 4) {
+			auto const block = _mm_loadu_si128(
+			    reinterpret_cast<__m128i const*>(codes.data() + index));
+			auto found = static_cast<unsigned>(_mm_movemask_ps(
+			    _mm_castsi128_ps(_mm_cmpeq_epi32(block, pattern))));
+			while (found) {
+				auto const lane = std::countr_zero(found);
+				result.insert(list.rows[index + lane]);
+				found &= found - 1;
+			}
+		}
+#endif
+		for (; index < codes.size(); ++index) {
+			if (codes[index] == *code) result.insert(list.rows[index]);
+		}
+		return result;
+	}
+}  // namespace movies
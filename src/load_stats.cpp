@@ -0,0 +1,34 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#include <movies/load_stats.hpp>
+
+namespace movies {
+	using namespace std::literals;
+
+	load_stats& load_stats::operator+=(load_stats const& rhs) noexcept {
+#define X_ADD(NAME) NAME += rhs.NAME;
+		MOVIES_LOAD_TIMERS_X(X_ADD)
+		MOVIES_LOAD_COUNTERS_X(X_ADD)
+#undef X_ADD
+		return *this;
+	}
+
+	json::node load_stats::to_json() const {
+		json::map timers{};
+		json::map counters{};
+#define X_TIMER(NAME) \
+	timers[u8## #NAME##s] = static_cast<long long>(NAME.count());
+#define X_COUNTER(NAME) \
+	counters[u8## #NAME##s] = static_cast<long long>(NAME);
+		MOVIES_LOAD_TIMERS_X(X_TIMER)
+		MOVIES_LOAD_COUNTERS_X(X_COUNTER)
+#undef X_COUNTER
+#undef X_TIMER
+
+		json::map result{};
+		result[u8"timers"s] = std::move(timers);
+		result[u8"counters"s] = std::move(counters);
+		return result;
+	}
+}  // namespace movies
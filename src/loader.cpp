@@ -1,11 +1,18 @@
 // Copyright (c) 2021 midnightBITS
 // This code is licensed under MIT license (see LICENSE for details)
 
+#include <deque>
 #include <io/file.hpp>
+#include <io/walk.hpp>
 #include <iostream>
 #include <movies/db_info.hpp>
 #include <movies/diff.hpp>
+#include <movies/load_stats.hpp>
+#include <movies/manifest.hpp>
+#include "library.hpp"
 #include "movie_info/impl.hpp"
+#include "normalize.hpp"
+#include "parallel.hpp"
 
 using namespace std::literals;
 
@@ -44,154 +51,324 @@ namespace movies {
 			return {as_string_v(id), get_mtime(path)};
 		}
 
-		file_ref info_ref(movies_dirs const& dirs, fs_string const& id) {
-			return get_ref(dirs.infos / (id + u8".json"), id);
+		file_ref seen_ref(file_stat const& stat, fs_string const& id) {
+			using duration = fs::file_time_type::duration;
+			auto const mtime = fs::file_time_type{duration{stat.mtime}};
+			return {as_string_v(id), fs2wall(mtime)};
 		}
+	}  // namespace
+
+	file_ref info_ref(movies_dirs const& dirs, fs_string const& id) {
+		return get_ref(dirs.infos / (id + u8".json"), id);
+	}
+
+	file_ref video_ref(movies_dirs const& dirs, fs_string const& id) {
+		auto mp4 = dirs.videos / (id + u8".mp4");
+		if (std::filesystem::exists(mp4)) return get_ref(mp4, id);
+		auto mkv = dirs.videos / (id + u8".mkv");
+		if (std::filesystem::exists(mkv)) return get_ref(mkv, id);
+		return get_ref(mp4, id);
+	}
+
+	file_ref info_ref(movies_dirs const& dirs,
+	                  fs_string const& id,
+	                  seen_files const& seen) {
+		auto it = seen.find(id);
+		if (it == seen.end()) return info_ref(dirs, id);
+		return seen_ref(it->second.stat, id);
+	}
+
+	file_ref video_ref(movies_dirs const& dirs,
+	                   fs_string const& id,
+	                   seen_files const& seen) {
+		auto it = seen.find(id);
+		if (it == seen.end()) return video_ref(dirs, id);
+		return seen_ref(it->second.stat, id);
+	}
 
-		file_ref video_ref(movies_dirs const& dirs, fs_string const& id) {
-			auto mp4 = dirs.videos / (id + u8".mp4");
-			if (std::filesystem::exists(mp4)) return get_ref(mp4, id);
-			auto mkv = dirs.videos / (id + u8".mkv");
-			if (std::filesystem::exists(mkv)) return get_ref(mkv, id);
-			return get_ref(mp4, id);
+	namespace {
+		struct parsed_info {
+			fs_string id{};
+			movie_info info{};
+			json::conv_result status{json::conv_result::ok};
+			std::string debug{};
+			file_stat stat{};
+			bool cached{false};
+			// per job, so the workers do not share them
+			load_stats stats{};
+		};
+
+		void parse_info(parsed_info& job,
+		                movies_dirs const& dirs,
+		                alpha_2_aliases const& aka,
+		                bool store_updates,
+		                movie_info_fields fields) {
+			job.status = job.info.load(dirs.infos, as_view(job.id), aka,
+			                           job.debug, fields, job.stats);
+			++job.stats.parsed_infos;
+			if (job.status == json::conv_result::updated && store_updates) {
+				load_stats::timer timer{job.stats.store};
+				job.info.store(dirs.infos, as_view(job.id));
+				job.stat = file_stat::of(dirs.infos / (job.id + u8".json"));
+				++job.stats.stored_infos;
+			}
 		}
 
-		map<fs_string, movie_info> known_movies(movies_dirs const& dirs,
-		                                        bool store_updates) {
-			map<fs_string, movie_info> result{};
-			alpha_2_aliases aka{};
-			aka.load(dirs.infos / ".."sv);
+		// Reuses the manifest entry, if the file looks the same as the last
+		// time it was parsed. An entry with a pending update report is
+		// parsed again, when the caller wants the updates stored.
+		bool reuse_entry(parsed_info& job,
+		                 library_manifest const& manifest,
+		                 bool store_updates) {
+			auto it = manifest.entries.find(job.id);
+			if (it == manifest.entries.end()) return false;
+			auto const& entry = it->second;
+			if (entry.stat != job.stat) return false;
+			if (store_updates && !entry.debug.empty()) return false;
+
+			job.info = entry.info;
+			job.debug = entry.debug;
+			job.status = entry.debug.empty() ? json::conv_result::ok
+			                                 : json::conv_result::updated;
+			job.cached = true;
+			return true;
+		}
 
-			std::error_code ec{};
-			fs::recursive_directory_iterator iterator{dirs.infos, ec};
-			if (ec) return result;
-
-			static constexpr auto ext = u8".json"sv;
-			for (auto&& entry : iterator) {
-				if (fs::is_directory(entry.status())) continue;
-				if (entry.path().extension().u8string() != ext) continue;
-				auto const& json_path = entry.path();
-				auto u8ident =
-				    fs::relative(json_path, dirs.infos).generic_u8string();
-				u8ident = u8ident.substr(0, u8ident.length() - ext.length());
-
-				movie_info info{};
-				std::string debug{};
-				auto const load_result =
-				    info.load(dirs.infos, as_view(u8ident), aka, debug);
-				if (load_result == json::conv_result::failed) continue;
-				if (load_result == json::conv_result::updated) {
-					if (store_updates) {
-						info.store(dirs.infos, as_view(u8ident));
-						fputc('.', stdout);
-						fflush(stdout);
-					} else {
-						fprintf(stdout, "%.*s:%s\n",
-						        static_cast<int>(u8ident.size()),
-						        reinterpret_cast<char const*>(u8ident.data()),
-						        debug.c_str() ? debug.c_str() : "<null>");
-					}
-				}
-				result.insert({u8ident, std::move(info)});
+		void update_manifest(library_manifest& manifest,
+		                     file_stat const& aliases,
+		                     std::deque<parsed_info> const& parsed,
+		                     bool store_updates) {
+			library_manifest::changes changes{};
+			map<fs_string, library_manifest::entry> entries{};
+
+			for (auto const& job : parsed) {
+				if (job.status == json::conv_result::failed) continue;
+
+				auto it = manifest.entries.find(job.id);
+				if (it == manifest.entries.end())
+					changes.added.push_back(job.id);
+				else if (!job.cached && it->second.info != job.info)
+					changes.changed.push_back(job.id);
+
+				auto const pending =
+				    job.status == json::conv_result::updated && !store_updates;
+				entries.insert(
+				    {job.id, {job.stat, job.info, pending ? job.debug : ""s}});
 			}
 
-			return result;
+			for (auto const& [id, _] : manifest.entries) {
+				if (!entries.count(id)) changes.removed.push_back(id);
+			}
+
+			manifest.aliases = aliases;
+			manifest.entries = std::move(entries);
+			manifest.last_scan = std::move(changes);
 		}
+	}  // namespace
 
-		vector<fs_string> downloaded_movies(movies_dirs const& dirs) {
-			vector<fs_string> result{};
+	map<fs_string, movie_info> known_movies(movies_dirs const& dirs,
+	                                        bool store_updates,
+	                                        unsigned jobs,
+	                                        library_manifest* manifest,
+	                                        seen_files* seen,
+	                                        parsed_callback const* on_parsed,
+	                                        movie_info_fields fields,
+	                                        load_stats* stats,
+	                                        stop_flag const* stop) {
+		if (fields != movie_info_fields::all) {
+			store_updates = false;
+			manifest = nullptr;
+		}
 
-			std::error_code ec{};
-			fs::recursive_directory_iterator iterator{dirs.videos, ec};
-			if (ec) return result;
-
-			for (auto&& entry : iterator) {
-				if (fs::is_directory(entry.status())) continue;
-				auto const ext = entry.path().extension().u8string();
-				if (ext != u8".mp4"sv && ext != u8".mkv") continue;
-				auto const& movie_path = entry.path();
-				auto u8ident =
-				    fs::relative(movie_path, dirs.videos).generic_u8string();
-				u8ident = u8ident.substr(0, u8ident.length() - ext.length());
-				result.emplace_back(std::move(u8ident));
+		map<fs_string, movie_info> result{};
+		alpha_2_aliases aka{};
+		aka.load(dirs.infos / ".."sv);
+
+		auto const aliases =
+		    manifest ? file_stat::of(dirs.infos / ".."sv / "iso-alpha-2.json"sv)
+		             : file_stat{};
+		auto const reuse = manifest && manifest->aliases == aliases;
+
+		// The walk stays on this thread and feeds the parsers; a deque
+		// keeps the addresses handed to the workers stable, and also
+		// remembers the walk order for the (serial) merge below.
+		std::deque<parsed_info> parsed{};
+		work_queue<parsed_info*> queue{};
+		auto const workers = effective_jobs(jobs);
+		std::optional<worker_group> pool{};
+		auto const notify = [&](parsed_info const& job) {
+			if (on_parsed && job.status != json::conv_result::failed)
+				(*on_parsed)(job.id, job.info, job.stat);
+		};
+		auto const parse = [&](parsed_info& job) {
+			parse_info(job, dirs, aka, store_updates, fields);
+			notify(job);
+		};
+		if (workers > 1) {
+			pool.emplace(
+			    workers,
+			    [&](unsigned) {
+				    parsed_info* job{};
+				    // once stopped, the rest of the queue is only drained
+				    while (queue.pop(job)) {
+					    if (!stop || !stop->load(std::memory_order_relaxed))
+						    parse(*job);
+				    }
+			    },
+			    [&] { queue.close(); });
+		}
+
+		auto const on_json = [&](io::walk_entry const& entry) {
+			throw_if_stopped(stop);
+			auto& job = parsed.emplace_back();
+			job.id = entry.stem();
+			job.stat = {entry.size, entry.mtime.time_since_epoch().count()};
+			if (reuse && reuse_entry(job, *manifest, store_updates)) {
+				++job.stats.reused_infos;
+				notify(job);
+				return;
 			}
 
-			std::sort(result.begin(), result.end());
+			if (pool)
+				queue.push(&job);
+			else
+				parse(job);
+		};
 
-			return result;
+		static constexpr std::u8string_view exts[] = {u8".json"sv};
+		bool found_root{};
+		try {
+			found_root = io::walk(dirs.infos, exts, true, on_json);
+		} catch (...) {
+			queue.close();
+			throw;
 		}
 
-		vector<fs_string> split_simple(vector<fs_string>& infos,
-		                               vector<fs_string>& videos) {
-			vector<fs_string> result;
-			vector<fs_string> infos_left;
-			vector<fs_string> videos_left;
-
-			auto it_infos = infos.begin();
-			auto it_videos = videos.begin();
-
-			while (it_infos != infos.end() || it_videos != videos.end()) {
-				if (it_infos == infos.end()) {
-					videos_left.insert(videos_left.end(),
-					                   std::make_move_iterator(it_videos),
-					                   std::make_move_iterator(videos.end()));
-					break;
-				}
+		queue.close();
+		if (pool) pool->wait();
+		throw_if_stopped(stop);
+		if (!found_root) return result;
 
-				if (it_videos == videos.end()) {
-					infos_left.insert(infos_left.end(),
-					                  std::make_move_iterator(it_infos),
-					                  std::make_move_iterator(infos.end()));
-					break;
-				}
+		if (manifest)
+			update_manifest(*manifest, aliases, parsed, store_updates);
 
-				if (*it_infos == *it_videos) {
-					result.push_back(std::move(*it_infos));
-					++it_infos;
-					++it_videos;
-					continue;
+		for (auto& job : parsed) {
+			if (stats) {
+				*stats += job.stats;
+				++stats->info_files;
+			}
+			if (job.status == json::conv_result::failed) continue;
+			if (job.status == json::conv_result::updated) {
+				if (store_updates) {
+					fputc('.', stdout);
+					fflush(stdout);
+				} else {
+					fprintf(stdout, "%.*s:%s\n",
+					        static_cast<int>(job.id.size()),
+					        reinterpret_cast<char const*>(job.id.data()),
+					        job.debug.c_str() ? job.debug.c_str() : "<null>");
 				}
+			}
+			if (seen) seen->insert({job.id, {u8".json"s, job.stat}});
+			result.insert({std::move(job.id), std::move(job.info)});
+		}
 
-				if (*it_infos < *it_videos) {
-					infos_left.push_back(std::move(*it_infos));
-					++it_infos;
-					continue;
-				}
+		return result;
+	}
+
+	vector<fs_string> downloaded_movies(movies_dirs const& dirs,
+	                                    seen_files* seen,
+	                                    stop_flag const* stop) {
+		vector<fs_string> result{};
+
+		static constexpr std::u8string_view exts[] = {u8".mp4"sv, u8".mkv"sv};
+		auto const on_video = [&](io::walk_entry const& entry) {
+			throw_if_stopped(stop);
+			result.emplace_back(entry.stem());
+			if (!seen) return;
+
+			auto const mtime = entry.mtime.time_since_epoch().count();
+			seen_file file{fs_string{entry.extension}, {entry.size, mtime}};
+			auto [it, inserted] = seen->insert({result.back(), file});
+			if (!inserted && entry.extension == u8".mp4"sv)
+				it->second = std::move(file);
+		};
+		io::walk(dirs.videos, exts, seen != nullptr, on_video);
+
+		std::sort(result.begin(), result.end());
 
-				videos_left.push_back(std::move(*it_videos));
+		return result;
+	}
+
+	vector<fs_string> split_simple(vector<fs_string>& infos,
+	                               vector<fs_string>& videos) {
+		vector<fs_string> result;
+		vector<fs_string> infos_left;
+		vector<fs_string> videos_left;
+
+		auto it_infos = infos.begin();
+		auto it_videos = videos.begin();
+
+		while (it_infos != infos.end() || it_videos != videos.end()) {
+			if (it_infos == infos.end()) {
+				videos_left.insert(videos_left.end(),
+				                   std::make_move_iterator(it_videos),
+				                   std::make_move_iterator(videos.end()));
+				break;
+			}
+
+			if (it_videos == videos.end()) {
+				infos_left.insert(infos_left.end(),
+				                  std::make_move_iterator(it_infos),
+				                  std::make_move_iterator(infos.end()));
+				break;
+			}
+
+			if (*it_infos == *it_videos) {
+				result.push_back(std::move(*it_infos));
+				++it_infos;
 				++it_videos;
+				continue;
 			}
 
-			std::swap(infos, infos_left);
-			std::swap(videos, videos_left);
-			return result;
+			if (*it_infos < *it_videos) {
+				infos_left.push_back(std::move(*it_infos));
+				++it_infos;
+				continue;
+			}
+
+			videos_left.push_back(std::move(*it_videos));
+			++it_videos;
 		}
 
+		std::swap(infos, infos_left);
+		std::swap(videos, videos_left);
+		return result;
+	}
+
+	namespace {
 		string_type make_title(std::u8string_view input) {
 			auto const pos = input.find_first_of(u8" \t"sv);
 			if (pos != std::string_view::npos) return as_string_v(input);
 			auto result = as_string_v(input);
-			for (auto& byte : result) {
-				if (byte == '-' || byte == '_' || byte == '.' || byte == '/')
-					byte = ' ';
-			}
-			if (!result.empty())
-				result.front() =
-				    std::toupper(static_cast<unsigned char>(result.front()));
+			normalize::to_spaces(std::span{result}, u8"-_./");
+			normalize::capitalize_ascii(std::span{result});
 			return result;
 		}
+	}  // namespace
 
-		loaded_movie make_empty(std::optional<file_ref> const& video_file,
-		                        std::optional<file_ref> const& info_file) {
-			loaded_movie result{{}, video_file, info_file};
-			if (video_file)
-				result.title.items[{}].text = make_title(video_file->id);
-			else if (info_file)
-				result.title.items[{}].text = make_title(info_file->id);
+	loaded_movie make_empty(std::optional<file_ref> const& video_file,
+	                        std::optional<file_ref> const& info_file) {
+		loaded_movie result{{}, video_file, info_file};
+		if (video_file)
+			result.title.items[{}].text = make_title(video_file->id);
+		else if (info_file)
+			result.title.items[{}].text = make_title(info_file->id);
 
-			return result;
-		}
+		return result;
+	}
 
+	namespace {
 		template <typename Key,
 		          typename Value,
 		          typename Compare,
@@ -207,6 +384,132 @@ namespace movies {
 
 			return result;
 		}
+	}  // namespace
+
+	void stream_library(movies_config const& cfg,
+	                    bool store_updates,
+	                    library_manifest* manifest,
+	                    movie_sink const& sink,
+	                    bool early_exact,
+	                    movie_info_fields fields,
+	                    load_stats* stats,
+	                    stop_flag const* stop) {
+		load_stats ignored{};
+		auto& st = stats ? *stats : ignored;
+		load_stats::timer total_timer{st.total};
+
+		auto const& dirs = cfg.dirs;
+		seen_files seen_infos{};
+		seen_files seen_videos{};
+		// the videos are walked first, so an exact match is known as soon
+		// as its info is parsed
+		load_stats::timer video_timer{st.video_scan};
+		auto videos = downloaded_movies(dirs, &seen_videos, stop);
+		st.video_files = videos.size();
+		video_timer.stop();
+
+		parsed_callback on_parsed{};
+		if (early_exact) {
+			on_parsed = [&](fs_string const& id, movie_info const& info,
+			                file_stat const& stat) {
+				if (!std::binary_search(videos.begin(), videos.end(), id))
+					return;
+				auto video = video_ref(dirs, id, seen_videos);
+				sink({info, std::move(video), seen_ref(stat, id)});
+			};
+		}
+
+		load_stats::timer info_timer{st.info_scan};
+		auto jsons = known_movies(
+		    dirs, store_updates, cfg.jobs, manifest, &seen_infos,
+		    early_exact ? &on_parsed : nullptr,
+		    fields | movie_info_fields::title, &st, stop);
+		auto infos = keys_of(jsons);
+		info_timer.stop();
+
+		auto const info_of = [&](fs_string const& id) {
+			return info_ref(dirs, id, seen_infos);
+		};
+		auto const video_of = [&](fs_string const& id) {
+			return video_ref(dirs, id, seen_videos);
+		};
+
+		load_stats::timer split_timer{st.split_simple};
+		auto both = split_simple(infos, videos);
+		split_timer.stop();
+
+		load_stats::timer differ_timer{st.differ};
+		differ_counters differ_st{};
+		auto matching = differ{jsons,
+		                       infos,
+		                       videos,
+		                       &differ_st,
+		                       cfg.jobs,
+		                       similarity_metric::ratio,
+		                       manifest ? &manifest->fuzzy : nullptr,
+		                       stop}
+		                    .calc();
+		throw_if_stopped(stop);
+		st.ratio_evaluations += differ_st.ratio_evaluations;
+		st.real_quick_pruned += differ_st.real_quick_pruned;
+		st.lcs_pruned += differ_st.lcs_pruned;
+		st.fuzzy_cache_hits += differ_st.fuzzy_cache_hits;
+		differ_timer.stop();
+
+		// already handed over by on_parsed
+		if (early_exact) both.clear();
+
+		load_stats::timer assembly_timer{st.assembly};
+
+		for (auto const& id : both) {
+			auto it = jsons.find(id);
+			if (it == jsons.end()) {
+				[[unlikely]] sink(make_empty(video_of(id), info_of(id)));
+				continue;
+			}
+			auto& mv = it->second;
+			sink({std::move(mv), video_of(id), info_of(id)});
+		}
+
+		for (auto const& diff : matching) {
+			auto it = jsons.find(diff.info);
+			if (it == jsons.end()) {
+				[[unlikely]] sink(
+				    make_empty(video_of(diff.video), info_of(diff.info)));
+				continue;
+			}
+			auto& mv = it->second;
+			sink({std::move(mv), video_of(diff.video), info_of(diff.info)});
+		}
+
+		for (auto const& id : videos)
+			sink(make_empty(video_of(id), std::nullopt));
+
+		for (auto const& id : infos) {
+			auto it = jsons.find(id);
+			if (it == jsons.end()) {
+				[[unlikely]] sink(make_empty(std::nullopt, info_of(id)));
+				continue;
+			}
+			auto& mv = it->second;
+			sink({std::move(mv), std::nullopt, info_of(id)});
+		}
+	}
+
+	namespace {
+		vector<loaded_movie> load_library(movies_config const& cfg,
+		                                  bool store_updates,
+		                                  library_manifest* manifest,
+		                                  movie_info_fields fields,
+		                                  load_stats* stats = nullptr) {
+			vector<loaded_movie> movies{};
+			auto const sink = [&](loaded_movie&& movie) {
+				movies.push_back(std::move(movie));
+			};
+			stream_library(cfg, store_updates, manifest, sink, false, fields,
+			               stats);
+			return movies;
+		}
 
 		struct db_type_traits
 		    : public enum_traits_helper<db_type_traits, db_type> {
@@ -244,7 +547,7 @@ namespace movies {
 
 	void movies_config::read(fs::path const& config_filename,
 	                         callback const& cb) {
-		auto const data = io::contents(config_filename);
+		auto const data = io::mapped_file::open(config_filename);
 		auto node = json::read_json({data.data(), data.size()});
 		auto json_path_str = cast<json::string>(node, u8"path"s);
 		auto json_path_dict = cast<json::map>(node, u8"path"s);
@@ -254,7 +557,8 @@ namespace movies {
 
 		fs::path cfg_dir = config_filename.parent_path();
 
-		*this = movies_config{};
+		// jobs is a property of this process, not of the library
+		*this = movies_config{.jobs = jobs};
 		if (json_title) title = as_string_v(*json_title);
 		if (json_adult) adult = db_type_traits::value_for(*json_adult);
 
@@ -313,55 +617,29 @@ namespace movies {
 	}
 
 	vector<loaded_movie> movies_config::load(bool store_updates) const {
-		auto jsons = known_movies(dirs, store_updates);
-		auto infos = keys_of(jsons);
-		auto videos = downloaded_movies(dirs);
-
-		auto both = split_simple(infos, videos);
-		auto matching = differ{jsons, infos, videos}.calc();
-
-		vector<loaded_movie> movies{};
-		movies.reserve(both.size() + matching.size() + infos.size() +
-		               videos.size());
-
-		for (auto const& id : both) {
-			auto it = jsons.find(id);
-			if (it == jsons.end()) {
-				[[unlikely]] movies.push_back(
-				    make_empty(video_ref(dirs, id), info_ref(dirs, id)));
-				continue;
-			}
-			auto& mv = it->second;
-			movies.push_back(
-			    {std::move(mv), video_ref(dirs, id), info_ref(dirs, id)});
-		}
+		return load(store_updates, movie_info_fields::all, nullptr, nullptr);
+	}
 
-		for (auto const& diff : matching) {
-			auto it = jsons.find(diff.info);
-			if (it == jsons.end()) {
-				[[unlikely]] movies.push_back(make_empty(
-				    video_ref(dirs, diff.video), info_ref(dirs, diff.info)));
-				continue;
-			}
-			auto& mv = it->second;
-			movies.push_back({std::move(mv), video_ref(dirs, diff.video),
-			                  info_ref(dirs, diff.info)});
-		}
+	vector<loaded_movie> movies_config::load(bool store_updates,
+	                                         library_manifest& manifest) const {
+		return load(store_updates, movie_info_fields::all, &manifest, nullptr);
+	}
 
-		for (auto const& id : videos)
-			movies.push_back(make_empty(video_ref(dirs, id), std::nullopt));
+	vector<loaded_movie> movies_config::load(bool store_updates,
+	                                         movie_info_fields fields) const {
+		return load(store_updates, fields, nullptr, nullptr);
+	}
 
-		for (auto const& id : infos) {
-			auto it = jsons.find(id);
-			if (it == jsons.end()) {
-				[[unlikely]] movies.push_back(
-				    make_empty(std::nullopt, info_ref(dirs, id)));
-				continue;
-			}
-			auto& mv = it->second;
-			movies.push_back({std::move(mv), std::nullopt, info_ref(dirs, id)});
-		}
+	vector<loaded_movie> movies_config::load(bool store_updates,
+	                                         load_stats& stats) const {
+		return load(store_updates, movie_info_fields::all, nullptr, &stats);
+	}
 
-		return movies;
+	vector<loaded_movie> movies_config::load(bool store_updates,
+	                                         movie_info_fields fields,
+	                                         library_manifest* manifest,
+	                                         load_stats* stats) const {
+		if (stats) *stats = {};
+		return load_library(*this, store_updates, manifest, fields, stats);
 	}
 }  // namespace movies
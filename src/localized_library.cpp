@@ -0,0 +1,179 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#include <algorithm>
+#include <movies/localized_library.hpp>
+#include <numeric>
+#include <utility>
+
+namespace movies {
+	localized_library::localized_library(language_preference langs)
+	    : langs_{std::move(langs)} {}
+
+	localized_library::localized_library(std::vector<loaded_movie> movies,
+	                                     language_preference langs)
+	    : langs_{std::move(langs)}, movies_{std::move(movies)} {
+		ids_.reserve(movies_.size());
+		for (auto const& movie : movies_)
+			ids_.push_back(movie.get_id());
+
+		if (!std::is_sorted(ids_.begin(), ids_.end())) {
+			std::vector<std::size_t> order(movies_.size());
+			std::iota(order.begin(), order.end(), std::size_t{});
+			std::sort(order.begin(), order.end(),
+			          [&](std::size_t lhs, std::size_t rhs) {
+				          return ids_[lhs] < ids_[rhs];
+			          });
+
+			std::vector<loaded_movie> movies_copy{};
+			std::vector<string_type> ids_copy{};
+			movies_copy.reserve(order.size());
+			ids_copy.reserve(order.size());
+			for (auto const index : order) {
+				movies_copy.push_back(std::move(movies_[index]));
+				ids_copy.push_back(std::move(ids_[index]));
+			}
+			movies_ = std::move(movies_copy);
+			ids_ = std::move(ids_copy);
+		}
+
+		picks_.reserve(movies_.size());
+		for (auto const& movie : movies_)
+			picks_.push_back(localize(movie));
+	}
+
+	void localized_library::set_languages(language_preference langs) {
+		langs_ = std::move(langs);
+		for (std::size_t row = 0; row < movies_.size(); ++row)
+			picks_[row] = localize(movies_[row]);
+	}
+
+	void localized_library::apply(library_delta const& delta) {
+		if (delta.empty()) return;
+
+		std::vector<std::pair<string_type, loaded_movie const*>> incoming{};
+		incoming.reserve(delta.added.size() + delta.changed.size());
+		for (auto const* list : {&delta.added, &delta.changed}) {
+			for (auto const& movie : *list)
+				incoming.emplace_back(movie.get_id(), &movie);
+		}
+		std::stable_sort(incoming.begin(), incoming.end(),
+		                 [](auto const& lhs, auto const& rhs) {
+			                 return lhs.first < rhs.first;
+		                 });
+
+		std::vector<string_type> removed{delta.removed};
+		std::sort(removed.begin(), removed.end());
+
+		// one pass over both sorted lists; the rows, which were not
+		// touched, keep what they resolved to
+		std::vector<loaded_movie> movies{};
+		std::vector<string_type> ids{};
+		std::vector<picks> positions{};
+		auto const capacity = movies_.size() + incoming.size();
+		movies.reserve(capacity);
+		ids.reserve(capacity);
+		positions.reserve(capacity);
+
+		auto const add = [&](string_type id, loaded_movie const& movie) {
+			movies.push_back(movie);
+			ids.push_back(std::move(id));
+			positions.push_back(localize(movie));
+		};
+
+		std::size_t row = 0;
+		auto next = incoming.begin();
+		while (row < movies_.size() || next != incoming.end()) {
+			if (next != incoming.end() &&
+			    (row == movies_.size() || next->first <= ids_[row])) {
+				if (row < movies_.size() && next->first == ids_[row]) ++row;
+				// a movie listed twice ends up as its last version
+				auto last = next;
+				while (std::next(last) != incoming.end() &&
+				       std::next(last)->first == next->first)
+					++last;
+				add(std::move(next->first), *last->second);
+				next = std::next(last);
+				continue;
+			}
+
+			if (!std::binary_search(removed.begin(), removed.end(),
+			                        ids_[row])) {
+				movies.push_back(std::move(movies_[row]));
+				ids.push_back(std::move(ids_[row]));
+				positions.push_back(picks_[row]);
+			}
+			++row;
+		}
+
+		movies_ = std::move(movies);
+		ids_ = std::move(ids);
+		picks_ = std::move(positions);
+	}
+
+	std::optional<std::size_t> localized_library::find(
+	    string_view_type id) const noexcept {
+		auto it = std::lower_bound(
+		    ids_.begin(), ids_.end(), id,
+		    [](string_type const& lhs, string_view_type rhs) {
+			    return string_view_type{lhs} < rhs;
+		    });
+		if (it == ids_.end() || *it != id) return std::nullopt;
+		return static_cast<std::size_t>(it - ids_.begin());
+	}
+
+	title_info const* localized_library::title(
+	    std::size_t row) const noexcept {
+		return at(movies_[row].title, index_of(row, field::title));
+	}
+
+	string_type const* localized_library::tagline(
+	    std::size_t row) const noexcept {
+		return at(movies_[row].tagline, index_of(row, field::tagline));
+	}
+
+	string_type const* localized_library::summary(
+	    std::size_t row) const noexcept {
+		return at(movies_[row].summary, index_of(row, field::summary));
+	}
+
+	image_url const* localized_library::highlight(
+	    std::size_t row) const noexcept {
+		return at(movies_[row].image.highlight,
+		          index_of(row, field::highlight));
+	}
+
+	poster_info const* localized_library::poster(
+	    std::size_t row) const noexcept {
+		return at(movies_[row].image.poster, index_of(row, field::poster));
+	}
+
+	template <typename Value>
+	localized_library::position localized_library::pick(
+	    translatable<Value> const& items) const noexcept {
+		auto it = items.find(langs_);
+		if (it == items.end()) return missing;
+		auto const index = it - items.begin();
+		// more translations than a position can tell apart
+		if (index >= missing) return missing;
+		return static_cast<position>(index);
+	}
+
+	template <typename Value>
+	Value const* localized_library::at(translatable<Value> const& items,
+	                                   position index) noexcept {
+		if (index == missing) return nullptr;
+		return &items.items.begin()[index].second;
+	}
+
+	localized_library::picks localized_library::localize(
+	    loaded_movie const& movie) const noexcept {
+		return {
+		    pick(movie.title),
+		    pick(movie.tagline),
+		    pick(movie.summary),
+		    pick(movie.image.highlight),
+		    pick(movie.image.poster),
+		};
+	}
+}  // namespace movies
@@ -0,0 +1,121 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#include <io/file.hpp>
+#include <json/json.hpp>
+#include <movies/manifest.hpp>
+
+namespace movies {
+	using namespace std::literals;
+
+	namespace {
+		static constexpr auto MANIFEST_VERSION = 1ll;
+
+		long long ticks(fs::file_time_type const& time) {
+			return static_cast<long long>(time.time_since_epoch().count());
+		}
+
+		json::map stat_to_json(file_stat const& stat) {
+			json::map result{};
+			result[u8"size"s] = static_cast<long long>(stat.size);
+			result[u8"mtime"s] = stat.mtime;
+			return result;
+		}
+
+		bool stat_from_json(json::node const& node, file_stat& stat) {
+			auto size = cast<long long>(node, u8"size"s);
+			auto mtime = cast<long long>(node, u8"mtime"s);
+			if (!size || !mtime) return false;
+			stat.size = static_cast<std::uintmax_t>(*size);
+			stat.mtime = *mtime;
+			return true;
+		}
+	}  // namespace
+
+	file_stat file_stat::of(fs::path const& path) {
+		std::error_code ec{};
+		file_stat result{};
+		result.size = fs::file_size(path, ec);
+		if (ec) return {};
+		auto const mtime = fs::last_write_time(path, ec);
+		if (ec) return {};
+		result.mtime = ticks(mtime);
+		return result;
+	}
+
+	file_stat file_stat::of(fs::directory_entry const& entry) {
+		std::error_code ec{};
+		file_stat result{};
+		result.size = entry.file_size(ec);
+		if (ec) return {};
+		auto const mtime = entry.last_write_time(ec);
+		if (ec) return {};
+		result.mtime = ticks(mtime);
+		return result;
+	}
+
+	bool library_manifest::load(fs::path const& filename) {
+		*this = library_manifest{};
+
+		auto const data = io::mapped_file::open(filename);
+		if (!data) return false;
+		auto node = json::read_json({data.data(), data.size()});
+
+		auto version = cast<long long>(node, u8"version"s);
+		if (!version || *version != MANIFEST_VERSION) return false;
+
+		auto json_aliases = cast<json::map>(node, u8"aliases"s);
+		auto json_entries = cast<json::map>(node, u8"entries"s);
+		if (!json_aliases || !json_entries ||
+		    !stat_from_json(*json_aliases, aliases))
+			return false;
+
+		// older manifests have no fuzzy scores, which is not an error
+		if (auto json_fuzzy = cast<json::map>(node, u8"fuzzy"s))
+			fuzzy.from_json(*json_fuzzy);
+
+		for (auto const& [id, json_entry] : *json_entries) {
+			auto json_info = cast<json::map>(json_entry, u8"info"s);
+			auto json_debug = cast<json::string>(json_entry, u8"debug"s);
+
+			entry item{};
+			if (!json_info || !stat_from_json(json_entry, item.stat)) continue;
+
+			std::string dbg{};
+			if (::json::load(*json_info, item.info, dbg) ==
+			    json::conv_result::failed)
+				continue;
+			if (json_debug) item.debug = as_ascii_string_v(*json_debug);
+
+			entries.insert({as_fs_string_v(id), std::move(item)});
+		}
+
+		return true;
+	}
+
+	bool library_manifest::store(fs::path const& filename) const {
+		json::map json_entries{};
+		for (auto const& [id, item] : entries) {
+			auto json_entry = stat_to_json(item.stat);
+			json_entry[u8"info"s] = item.info.to_json();
+			if (!item.debug.empty())
+				json_entry[u8"debug"s] = as_json_string_v(item.debug);
+			json_entries[as_json_string_v(id)] = std::move(json_entry);
+		}
+
+		json::map root{};
+		root[u8"version"s] = MANIFEST_VERSION;
+		root[u8"aliases"s] = stat_to_json(aliases);
+		root[u8"entries"s] = std::move(json_entries);
+		root[u8"fuzzy"s] = fuzzy.to_json();
+
+		std::error_code ec{};
+		fs::create_directories(filename.parent_path(), ec);
+
+		// a crash half-way through must not leave a manifest, which
+		// would be rejected as a whole on the next load
+		std::u8string output{};
+		json::write_json(output, root, json::concise);
+		return io::replace_contents(filename, output);
+	}
+}  // namespace movies
@@ -295,7 +295,7 @@ namespace movies::v1 {
 
 	template <typename T>
 	json::conv_result clear(translatable<T>& data) noexcept {
-		std::vector<std::string> keys{};
+		std::vector<language_key> keys{};
 		keys.reserve(data.items.size());
 		for (auto const& [key, value] : data.items) {
 			if (empty(value)) keys.push_back(key);
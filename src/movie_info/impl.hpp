@@ -145,6 +145,86 @@ namespace movies::v1 {
 		return json::load_or_value(src, key, value, dbg);
 	}
 
+	// The json library knows nothing about the pool; the [interned]
+	// attributes are stored as plain strings and interned straight from
+	// the nodes on the way in.
+	inline std::vector<std::u8string> plain_strings(
+	    std::vector<interned_string> const& values) {
+		std::vector<std::u8string> result{};
+		result.reserve(values.size());
+		for (auto const& value : values)
+			result.push_back(value.str());
+		return result;
+	}
+
+	inline void intern_all(std::vector<std::u8string> const& plain,
+	                       std::vector<interned_string>& values) {
+		values.clear();
+		values.reserve(plain.size());
+		for (auto const& value : plain)
+			values.emplace_back(value);
+	}
+
+	// The usual shape, an array of strings, is interned one node at a
+	// time. Anything else (a missing key, a single value, an item, which
+	// is not a string) is left to the json library and returns false.
+	inline bool intern_array(json::map const& src,
+	                         std::u8string const& key,
+	                         std::vector<interned_string>& values) {
+		auto const it = src.find(key);
+		if (it == src.end()) return false;
+		auto const items = json::cast<json::array>(it->second);
+		if (!items) return false;
+		for (auto const& item : *items) {
+			if (!json::cast<json::string>(item)) return false;
+		}
+
+		values.clear();
+		values.reserve(items->size());
+		for (auto const& item : *items) {
+			values.emplace_back(
+			    std::u8string_view{*json::cast<json::string>(item)});
+		}
+		return true;
+	}
+
+	inline void store(json::map& dst,
+	                  std::u8string_view const& key,
+	                  std::vector<interned_string> const& values) {
+		return json::store(dst, key, plain_strings(values));
+	}
+
+	inline void store_or_value(json::map& dst,
+	                           std::u8string_view const& key,
+	                           std::vector<interned_string> const& values) {
+		return json::store(dst, key, plain_strings(values));
+	}
+
+	inline json::conv_result load(json::map const& src,
+	                              std::u8string const& key,
+	                              std::vector<interned_string>& value,
+	                              std::string& dbg) {
+		if (intern_array(src, key, value)) return json::conv_result::ok;
+
+		// if the key is missing, the value stays as it was
+		auto plain = plain_strings(value);
+		auto const result = json::load(src, key, plain, dbg);
+		intern_all(plain, value);
+		return result;
+	}
+
+	inline json::conv_result load_or_value(json::map const& src,
+	                                       std::u8string const& key,
+	                                       std::vector<interned_string>& value,
+	                                       std::string& dbg) {
+		if (intern_array(src, key, value)) return json::conv_result::ok;
+
+		auto plain = plain_strings(value);
+		auto const result = json::load_or_value(src, key, plain, dbg);
+		intern_all(plain, value);
+		return result;
+	}
+
 	inline json::conv_result load(json::node const& src,
 	                              std::string& val,
 	                              std::string& dbg) {
@@ -268,6 +348,40 @@ namespace movies::v1 {
 		return res;
 	}
 
+	// Part of the outer projection mask, which covers the attributes of
+	// a nested [projection] interface, starting at the given bit.
+	template <typename Inner, typename Outer>
+	constexpr Inner sub_fields(Outer fields, unsigned offset) noexcept {
+		auto const bits = static_cast<std::uint64_t>(fields) >> offset;
+		return static_cast<Inner>(bits &
+		                          static_cast<std::uint64_t>(Inner::all));
+	}
+
+	template <typename Payload, typename Fields>
+	concept LoadsProjection = requires(Payload& obj,
+	                                   json::map const& data,
+	                                   std::string& dbg,
+	                                   Fields fields) {
+		obj.from_json(data, dbg, fields);
+	};
+
+	template <typename Fields, LoadsProjection<Fields> Payload>
+	inline json::conv_result load(json::map const& src,
+	                              std::u8string const& key,
+	                              Payload& value,
+	                              Fields fields,
+	                              std::string& dbg) {
+		if (fields == Fields::all) return v1::load(src, key, value, dbg);
+
+		auto it = src.find(key);
+		if (it == src.end()) return json::conv_result::opt;
+		auto const obj = json::cast<json::map>(it->second);
+		if (!obj) return json::conv_result::failed;
+		auto res = value.from_json(*obj, dbg, fields);
+		json::append_name(res, key, dbg);
+		return res;
+	}
+
 	template <json::JsonStorableValue ValueType>
 	inline json::conv_result store(json::map& data,
 	                               std::u8string_view prefix,
@@ -309,7 +423,7 @@ namespace movies::v1 {
 			} else if (key[prefix.length()] == u8':') {
 				LOAD_PREFIXED_ITEM();
 				auto view = as_ascii_view(key).substr(prefix.length() + 1);
-				value.items[{view.data(), view.size()}] = std::move(item);
+				value.items[view] = std::move(item);
 			}
 		}
 		return result;
@@ -30,7 +30,7 @@ namespace movies::v1 {
 	}
 
 	template <typename T>
-	inline void merge_new_prefixed(std::string const& key,
+	inline void merge_new_prefixed(language_key const& key,
 	                               T const& next,
 	                               translatable<T>& old_data,
 	                               json::conv_result& result) {
@@ -41,7 +41,7 @@ namespace movies::v1 {
 	}
 
 	template <typename T>
-	inline void merge_new_prefixed(std::string const& key,
+	inline void merge_new_prefixed(language_key const& key,
 	                               T const& next,
 	                               translatable<T>& old_data,
 	                               json::conv_result& result,
@@ -52,7 +52,7 @@ namespace movies::v1 {
 		old_data.items.insert(it, {key, next});
 	}
 
-	inline void merge_new_prefixed(std::string const& key,
+	inline void merge_new_prefixed(language_key const& key,
 	                               title_info const& next,
 	                               translatable<title_info>& old_data,
 	                               json::conv_result& result,
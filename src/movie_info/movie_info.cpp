@@ -5,6 +5,7 @@
 #include <io/file.hpp>
 #include <movies/db_info.hpp>
 #include <movies/image_url.hpp>
+#include <movies/load_stats.hpp>
 #include <movies/movie_info.hpp>
 
 #include "impl.hpp"
@@ -201,7 +202,7 @@ namespace movies::v1 {
 
 	void movie_info::add_tag(string_view_type tag) {
 		auto it = std::find(tags.begin(), tags.end(), tag);
-		if (it == tags.end()) tags.emplace_back(tag.data(), tag.size());
+		if (it == tags.end()) tags.emplace_back(tag);
 	}
 
 	void movie_info::remove_tag(string_view_type tag) {
@@ -237,23 +238,50 @@ namespace movies::v1 {
 	                                   string_view_type key,
 	                                   alpha_2_aliases const& aka,
 	                                   std::string& dbg) {
+		load_stats ignored{};
+		return load(nfo_root, key, aka, dbg, movie_info_fields::all, ignored);
+	}
+
+	json::conv_result movie_info::load(fs::path const& nfo_root,
+	                                   string_view_type key,
+	                                   alpha_2_aliases const& aka,
+	                                   std::string& dbg,
+	                                   movie_info_fields fields,
+	                                   load_stats& stats) {
 		auto const json_filename = nfo_root / make_json(key);
 
-		auto const data = io::contents(json_filename);
+		load_stats::timer parse_timer{stats.json_parse};
+		auto const data = io::mapped_file::open(json_filename);
+		stats.bytes_read += data.size();
 		auto node = json::read_json({data.data(), data.size()});
+		parse_timer.stop();
 
 		auto result = json::conv_result::ok;
-		LOAD_EX(::json::load(node, *this, dbg));
+		load_stats::timer from_json_timer{stats.from_json};
+		if (fields == movie_info_fields::all) {
+			LOAD_EX(::json::load(node, *this, dbg));
+		} else {
+			auto const map = cast<json::map>(node);
+			if (!map) return json::conv_result::failed;
+			LOAD_EX(from_json(*map, dbg, fields));
+		}
+		from_json_timer.stop();
 
+		load_stats::timer postproc_timer{stats.postproc};
 		if (map_countries(aka)) {
 			result = json::conv_result::updated;
 			dbg.append("\n- Country list updated to ISO alpha2"sv);
 		}
+
+		// whatever was updated, the file cannot be written back from here
+		if (fields != movie_info_fields::all &&
+		    result == json::conv_result::updated)
+			result = json::conv_result::ok;
 		return result;
 	}
 
 	bool movie_info::map_countries(alpha_2_aliases const& aka) {
-		std::vector<string_type> mapped_countries{};
+		std::vector<interned_string> mapped_countries{};
 		mapped_countries.reserve(countries.size());
 		for (auto const& list : countries) {
 			auto items = split_s('/', list);
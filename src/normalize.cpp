@@ -0,0 +1,205 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#include "normalize.hpp"
+#include <bit>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MOVIES_NORMALIZE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace movies::normalize {
+	namespace {
+		constexpr std::size_t block = 16;
+
+		inline char8_t ascii_lower(char8_t c) noexcept {
+			if (c >= u8'A' && c <= u8'Z') return static_cast<char8_t>(c + 0x20);
+			return c;
+		}
+
+		inline bool is_continuation(char8_t c) noexcept {
+			return (c & 0xC0) == 0x80;
+		}
+
+		// The uppercase letters of one case pair alternate with the
+		// lowercase ones, starting at an even (or odd) code point.
+		inline char32_t alternating(char32_t c, bool upper_is_odd) noexcept {
+			return ((c & 1) != 0) == upper_is_odd ? c + 1 : c;
+		}
+
+		char32_t lower_of(char32_t c) noexcept {
+			// Latin-1, without the multiplication sign
+			if (c >= 0xC0 && c <= 0xDE && c != 0xD7) return c + 0x20;
+
+			// Latin Extended-A
+			if (c >= 0x100 && c <= 0x17F) {
+				if (c == 0x130 || c == 0x131 || c == 0x138 || c == 0x149 ||
+				    c == 0x17F)
+					return c;
+				if (c == 0x178) return 0xFF;
+				auto const upper_is_odd =
+				    (c >= 0x139 && c <= 0x148) || (c >= 0x179 && c <= 0x17E);
+				return alternating(c, upper_is_odd);
+			}
+
+			// Greek
+			if (c == 0x386) return 0x3AC;
+			if (c >= 0x388 && c <= 0x38A) return c + 0x25;
+			if (c == 0x38C) return 0x3CC;
+			if (c == 0x38E || c == 0x38F) return c + 0x3F;
+			if (c >= 0x391 && c <= 0x3AB && c != 0x3A2) return c + 0x20;
+			if (c == 0x370 || c == 0x372 || c == 0x376) return c + 1;
+			if (c == 0x37F) return 0x3F3;
+			if (c == 0x3CF) return 0x3D7;
+			if (c >= 0x3D8 && c <= 0x3EF) return alternating(c, false);
+			if (c == 0x3F4) return 0x3B8;
+			if (c == 0x3F7 || c == 0x3FA) return c + 1;
+			if (c == 0x3F9) return 0x3F2;
+			if (c >= 0x3FD && c <= 0x3FF) return c - 0x82;
+
+			// Cyrillic
+			if (c >= 0x400 && c <= 0x40F) return c + 0x50;
+			if (c >= 0x410 && c <= 0x42F) return c + 0x20;
+			if ((c >= 0x460 && c <= 0x481) || (c >= 0x48A && c <= 0x4BF) ||
+			    (c >= 0x4D0 && c <= 0x52F))
+				return alternating(c, false);
+			if (c == 0x4C0) return 0x4CF;
+			if (c >= 0x4C1 && c <= 0x4CE) return alternating(c, true);
+
+			// Armenian
+			if (c >= 0x531 && c <= 0x556) return c + 0x30;
+
+			// Latin Extended Additional, with the Vietnamese letters
+			if ((c >= 0x1E00 && c <= 0x1E95) || (c >= 0x1EA0 && c <= 0x1EFF))
+				return alternating(c, false);
+
+			// fullwidth Latin
+			if (c >= 0xFF21 && c <= 0xFF3A) return c + 0x20;
+
+			return c;
+		}
+
+		// Lowercases the character at the start of the text and returns
+		// the number of bytes it took. Only the two- and three-byte
+		// sequences have letters with a mapping; anything else is passed
+		// over a byte at a time.
+		std::size_t lower_one(std::span<char8_t> text) noexcept {
+			auto const lead = text[0];
+			if (lead < 0x80) {
+				text[0] = ascii_lower(lead);
+				return 1;
+			}
+
+			if (lead >= 0xC2 && lead <= 0xDF && text.size() > 1 &&
+			    is_continuation(text[1])) {
+				auto const code = static_cast<char32_t>(
+				    ((lead & 0x1F) << 6) | (text[1] & 0x3F));
+				auto const lower = lower_of(code);
+				if (lower != code) {
+					text[0] = static_cast<char8_t>(0xC0 | (lower >> 6));
+					text[1] = static_cast<char8_t>(0x80 | (lower & 0x3F));
+				}
+				return 2;
+			}
+
+			if (lead >= 0xE0 && lead <= 0xEF && text.size() > 2 &&
+			    is_continuation(text[1]) && is_continuation(text[2])) {
+				auto const code = static_cast<char32_t>(
+				    ((lead & 0x0F) << 12) | ((text[1] & 0x3F) << 6) |
+				    (text[2] & 0x3F));
+				if (code < 0x800 || (code >= 0xD800 && code <= 0xDFFF))
+					return 1;
+				auto const lower = lower_of(code);
+				if (lower != code) {
+					text[0] = static_cast<char8_t>(0xE0 | (lower >> 12));
+					text[1] =
+					    static_cast<char8_t>(0x80 | ((lower >> 6) & 0x3F));
+					text[2] = static_cast<char8_t>(0x80 | (lower & 0x3F));
+				}
+				return 3;
+			}
+
+			return 1;
+		}
+
+#if defined(MOVIES_NORMALIZE_SSE2)
+		// Lowercases the ASCII bytes at the front of the block, up to the
+		// first non-ASCII one, and returns their number.
+		std::size_t lower_ascii_block(char8_t* data) noexcept {
+			auto* const at = reinterpret_cast<__m128i*>(data);
+			auto const bytes = _mm_loadu_si128(at);
+			auto const non_ascii =
+			    static_cast<unsigned>(_mm_movemask_epi8(bytes));
+			if (non_ascii) {
+				auto const ascii =
+				    static_cast<std::size_t>(std::countr_zero(non_ascii));
+				for (std::size_t index = 0; index < ascii; ++index)
+					data[index] = ascii_lower(data[index]);
+				return ascii;
+			}
+
+			// with no high bits set, the signed compares are safe
+			auto const upper =
+			    _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8('A' - 1)),
+			                  _mm_cmplt_epi8(bytes, _mm_set1_epi8('Z' + 1)));
+			_mm_storeu_si128(
+			    at, _mm_or_si128(bytes,
+			                     _mm_and_si128(upper, _mm_set1_epi8(0x20))));
+			return block;
+		}
+
+		void to_spaces_block(char8_t* data,
+		                     std::u8string_view separators) noexcept {
+			auto* const at = reinterpret_cast<__m128i*>(data);
+			auto const bytes = _mm_loadu_si128(at);
+			auto found = _mm_setzero_si128();
+			for (auto const separator : separators) {
+				found = _mm_or_si128(
+				    found,
+				    _mm_cmpeq_epi8(bytes, _mm_set1_epi8(static_cast<char>(
+				                              separator))));
+			}
+			_mm_storeu_si128(
+			    at, _mm_or_si128(_mm_andnot_si128(found, bytes),
+			                     _mm_and_si128(found, _mm_set1_epi8(' '))));
+		}
+#endif
+	}  // namespace
+
+	void lowercase(std::span<char8_t> text) noexcept {
+		std::size_t pos = 0;
+		while (pos < text.size()) {
+#if defined(MOVIES_NORMALIZE_SSE2)
+			if (pos + block <= text.size()) {
+				auto const ascii = lower_ascii_block(text.data() + pos);
+				pos += ascii;
+				if (ascii == block) continue;
+			}
+#endif
+			pos += lower_one(text.subspan(pos));
+		}
+	}
+
+	void to_spaces(std::span<char8_t> text,
+	               std::u8string_view separators) noexcept {
+		std::size_t pos = 0;
+#if defined(MOVIES_NORMALIZE_SSE2)
+		for (; pos + block <= text.size(); pos += block)
+			to_spaces_block(text.data() + pos, separators);
+#endif
+		for (; pos < text.size(); ++pos) {
+			if (separators.find(text[pos]) != std::u8string_view::npos)
+				text[pos] = u8' ';
+		}
+	}
+
+	void capitalize_ascii(std::span<char8_t> text) noexcept {
+		if (text.empty()) return;
+		auto& front = text.front();
+		if (front >= u8'a' && front <= u8'z')
+			front = static_cast<char8_t>(front - 0x20);
+	}
+}  // namespace movies::normalize
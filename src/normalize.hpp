@@ -0,0 +1,47 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#pragma once
+
+#include <span>
+#include <string_view>
+
+// The text normalization shared by the differ, the title_index, the
+// default titles of the loader and the country aliases. All of it works
+// in place: none of the mappings changes the length of the text.
+
+namespace movies::normalize {
+	// Runs of ASCII are lowercased sixteen bytes at a time. Everything
+	// else is decoded as UTF-8 and the simple lowercase mapping is
+	// applied to the letters of Latin-1, Latin Extended-A and Latin
+	// Extended Additional, of Greek, Cyrillic and Armenian, and of the
+	// fullwidth Latin, as long as the lowercase letter is encoded with as
+	// many bytes as the uppercase one (so U+0130 and U+1E9E are left
+	// alone). Any other code point, and any byte which is not a part of
+	// a valid sequence, is kept as it was.
+	void lowercase(std::span<char8_t> text) noexcept;
+
+	// Every byte found in the separators becomes a space. The separators
+	// must be ASCII, so a byte of a multibyte sequence is never changed.
+	void to_spaces(std::span<char8_t> text,
+	               std::u8string_view separators) noexcept;
+
+	// Uppercases the first letter, if it is an ASCII one.
+	void capitalize_ascii(std::span<char8_t> text) noexcept;
+
+	// For the builds, where string_type is std::string.
+	inline void lowercase(std::span<char> text) noexcept {
+		lowercase({reinterpret_cast<char8_t*>(text.data()), text.size()});
+	}
+
+	inline void to_spaces(std::span<char> text,
+	                      std::u8string_view separators) noexcept {
+		to_spaces({reinterpret_cast<char8_t*>(text.data()), text.size()},
+		          separators);
+	}
+
+	inline void capitalize_ascii(std::span<char> text) noexcept {
+		capitalize_ascii(
+		    {reinterpret_cast<char8_t*>(text.data()), text.size()});
+	}
+}  // namespace movies::normalize
@@ -0,0 +1,112 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace movies {
+	// 0 means "as many as the hardware has"; never returns 0.
+	inline unsigned effective_jobs(unsigned jobs) noexcept {
+		if (jobs) return jobs;
+		return (std::max)(1u, std::thread::hardware_concurrency());
+	}
+
+	template <typename Item>
+	class work_queue {
+	public:
+		void push(Item item) {
+			{
+				std::lock_guard lock{mtx_};
+				items_.push_back(std::move(item));
+			}
+			cv_.notify_one();
+		}
+
+		void close() {
+			{
+				std::lock_guard lock{mtx_};
+				closed_ = true;
+			}
+			cv_.notify_all();
+		}
+
+		// Blocks until there is an item to hand out, or until the queue is
+		// both closed and drained, in which case it returns false.
+		bool pop(Item& item) {
+			std::unique_lock lock{mtx_};
+			cv_.wait(lock, [this] { return closed_ || !items_.empty(); });
+			if (items_.empty()) return false;
+			item = std::move(items_.front());
+			items_.pop_front();
+			return true;
+		}
+
+	private:
+		std::mutex mtx_{};
+		std::condition_variable cv_{};
+		std::deque<Item> items_{};
+		bool closed_{false};
+	};
+
+	class worker_group {
+	public:
+		// For the workers, which run out of work on their own.
+		template <typename Worker>
+		worker_group(unsigned count, Worker const& worker)
+		    : worker_group(count, worker, [] {}) {}
+
+		// If not all the threads could be started, stop() is called to make
+		// the ones already running return (e.g. by closing their queue);
+		// they are joined before the exception leaves the constructor.
+		template <typename Worker, typename Stop>
+		worker_group(unsigned count, Worker const& worker, Stop const& stop) {
+			try {
+				threads_.reserve(count);
+				for (unsigned index = 0; index < count; ++index) {
+					threads_.emplace_back([this, worker, index] {
+						try {
+							worker(index);
+						} catch (...) {
+							std::lock_guard lock{mtx_};
+							if (!error_) error_ = std::current_exception();
+						}
+					});
+				}
+			} catch (...) {
+				stop();
+				join();
+				throw;
+			}
+		}
+
+		~worker_group() { join(); }
+
+		worker_group(worker_group const&) = delete;
+		worker_group& operator=(worker_group const&) = delete;
+
+		void join() {
+			for (auto& thread : threads_) {
+				if (thread.joinable()) thread.join();
+			}
+		}
+
+		// Joins all the workers and re-throws the first exception any of
+		// them has seen.
+		void wait() {
+			join();
+			if (error_) std::rethrow_exception(error_);
+		}
+
+	private:
+		std::vector<std::thread> threads_{};
+		std::mutex mtx_{};
+		std::exception_ptr error_{};
+	};
+}  // namespace movies
@@ -64,6 +64,36 @@ namespace boost::python::converter {
 			static PyTypeObject const* get_pytype() { return &PyUnicode_Type; }
 		};
 
+		struct interned_rvalue_from_python {
+			static unaryfunc* get_slot(PyObject* obj) {
+				return (PyUnicode_Check(obj)) ? &py_unicode_as_string_unaryfunc
+				                              : 0;
+			};
+
+			// the pool keeps its own copy of the bytes
+			static movies::interned_string extract(PyObject* intermediate) {
+				return movies::string_view_type(
+				    reinterpret_cast<char8_t const*>(
+				        PyBytes_AsString(intermediate)),
+				    static_cast<size_t>(PyBytes_Size(intermediate)));
+			}
+			static PyTypeObject const* get_pytype() { return &PyUnicode_Type; }
+		};
+
+		struct language_rvalue_from_python {
+			static unaryfunc* get_slot(PyObject* obj) {
+				return (PyUnicode_Check(obj)) ? &py_unicode_as_string_unaryfunc
+				                              : 0;
+			};
+
+			static movies::language_key extract(PyObject* intermediate) {
+				return std::string_view(
+				    PyBytes_AsString(intermediate),
+				    static_cast<size_t>(PyBytes_Size(intermediate)));
+			}
+			static PyTypeObject const* get_pytype() { return &PyUnicode_Type; }
+		};
+
 		struct path_rvalue_from_python {
 			// If the underlying object is "string-able" this will succeed
 			static unaryfunc* get_slot(PyObject* obj) {
@@ -98,6 +128,10 @@ namespace boost::python::converter {
 
 	void initialize_movies_converters() {
 		slot_rvalue_from_python<std::u8string, u8string_rvalue_from_python>{};
+		slot_rvalue_from_python<movies::interned_string,
+		                        interned_rvalue_from_python>{};
+		slot_rvalue_from_python<movies::language_key,
+		                        language_rvalue_from_python>{};
 		slot_rvalue_from_python<std::filesystem::path,
 		                        path_rvalue_from_python>{};
 		slot_rvalue_from_python<date::sys_seconds,
@@ -119,6 +153,7 @@ namespace boost::python::converter {
 		slot_optional_rvalue_from_python<std::string>{};
 
 		vector_<movies::string_type>("vector_str").def_vector();
+		vector_<movies::interned_string>("vector_interned_str").def_vector();
 
 		translatable_<movies::string_type>("translatable_str").def_tr();
 	}
@@ -14,6 +14,7 @@
 #include <boost/python/suite/indexing/map_indexing_suite.hpp>
 #include <boost/python/suite/indexing/vector_indexing_suite.hpp>
 #include <boost/python/tuple.hpp>
+#include <movies/types.hpp>
 #include <optional>
 #include <filesystem>
 
@@ -49,6 +50,12 @@ namespace boost::python {
 		    implicit_cast<ssize_t>(view.size()));
 	}
 
+	inline auto PyUnicode_from_language(movies::language_key const& key) {
+		auto const view = key.view();
+		return ::PyUnicode_FromStringAndSize(
+		    view.data(), implicit_cast<ssize_t>(view.size()));
+	}
+
 	inline auto PyUnicode_from_path(std::filesystem::path const& path) {
 		return PyUnicode_from_view(path.generic_u8string());
 	}
@@ -66,6 +73,12 @@ namespace boost::python {
 	BOOST_PYTHON_TO_PYTHON_BY_VALUE(date::sys_seconds,
 	                                PyLong_from_sys_seconds(x),
 	                                &PyLong_Type);
+	BOOST_PYTHON_TO_PYTHON_BY_VALUE(movies::interned_string,
+	                                PyUnicode_from_view(x),
+	                                &PyUnicode_Type);
+	BOOST_PYTHON_TO_PYTHON_BY_VALUE(movies::language_key,
+	                                PyUnicode_from_language(x),
+	                                &PyUnicode_Type);
 
 	template <typename T>
 	struct to_python_value<std::optional<T>&> : python::to_python_value<T&> {
@@ -119,11 +132,12 @@ namespace boost::python {
 			extract<std::string> class_name_extractor(class_name);
 			auto items_name = class_name_extractor();
 			items_name += "_items";
-			map_<std::string, value_type, NoProxy>(items_name.c_str())
-			    .def_map();
+			class_<map_type>(items_name.c_str())
+			    .def(map_indexing_suite<map_type, NoProxy>{});
 
 			cl.def_readonly("items", &Translatable::items)
 			    .def("find", &find_one)
+			    .def("find", &find_preferred)
 			    .def("update", &Translatable::update);
 		}
 
@@ -134,6 +148,14 @@ namespace boost::python {
 			if (it == translatable.end()) return std::nullopt;
 			return it->second;
 		}
+
+		static std::optional<value_type> find_preferred(
+		    Translatable& translatable,
+		    movies::language_preference const& langs) {
+			auto it = translatable.find(langs);
+			if (it == translatable.end()) return std::nullopt;
+			return it->second;
+		}
 	};
 
 	template <typename Value, bool NoProxy = true>
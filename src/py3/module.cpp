@@ -1,7 +1,14 @@
 #include <boost/python.hpp>
 #include <cerrno>
 #include <io/file.hpp>
+#include <movies/library_table.hpp>
+#include <movies/load_stats.hpp>
+#include <movies/localized_library.hpp>
 #include <movies/movie_info.hpp>
+#include <movies/stream.hpp>
+#include <movies/tag_index.hpp>
+#include <movies/title_index.hpp>
+#include <movies/watch.hpp>
 #include <py3/converter.hpp>
 #if defined(MOVIES_HAS_NAVIGATOR)
 #include <tangle/curl/proto.hpp>
@@ -72,8 +79,8 @@ namespace movies::v1 {
 		if (debug_on)
 			std::cerr << "-- movie_info.load_from(" << as_ascii_view(path)
 			          << ")\n";
-		auto file = io::file::open(as_fs_view(path), "rb");
-		if (!file) {
+		auto const bytes = io::mapped_file::open(as_fs_view(path));
+		if (!bytes) {
 			auto const view = as_ascii_view(path);
 			str path_{view.data(), view.length()};
 			errno = ENOENT;
@@ -82,7 +89,6 @@ namespace movies::v1 {
 			throw_error_already_set();
 		}
 
-		auto const bytes = io::contents(file);
 		if (debug_on) std::cerr << "-- json size: " << bytes.size() << '\n';
 		auto node = json::read_json({bytes.data(), bytes.size()});
 		std::string dbg;
@@ -154,6 +160,323 @@ namespace movies::v1 {
 		return self.load(store_updates);
 	}
 
+	std::vector<loaded_movie> movies_config__load_fields(
+	    movies_config const& self,
+	    bool store_updates,
+	    list const& fields) {
+		auto mask = movie_info_fields::none;
+		auto const count = len(fields);
+		for (decltype(len(fields)) index = 0; index < count; ++index) {
+			string_type const name = extract<string_type>(fields[index]);
+			auto const field = movie_info_fields_from_name(as_utf8_view(name));
+			if (!field) {
+				auto const message =
+				    "unknown movie_info field: " + as_ascii_string_v(name);
+				PyErr_SetString(PyExc_ValueError, message.c_str());
+				throw_error_already_set();
+			}
+			mask = mask | *field;
+		}
+		return self.load(store_updates, mask);
+	}
+
+	// The movies and {"timers": {...}, "counters": {...}}, with the timers
+	// in seconds.
+	boost::python::tuple movies_config__load_with_stats(
+	    movies_config const& self,
+	    bool store_updates) {
+		load_stats stats{};
+		auto movies =
+		    self.load(store_updates, movie_info_fields::all, nullptr, &stats);
+
+		dict timers{};
+		dict counters{};
+#define X_TIMER(NAME) \
+	timers[#NAME] = std::chrono::duration<double>{stats.NAME}.count();
+#define X_COUNTER(NAME) counters[#NAME] = stats.NAME;
+		MOVIES_LOAD_TIMERS_X(X_TIMER)
+		MOVIES_LOAD_COUNTERS_X(X_COUNTER)
+#undef X_COUNTER
+#undef X_TIMER
+
+		dict report{};
+		report["timers"] = timers;
+		report["counters"] = counters;
+		return boost::python::make_tuple(object{std::move(movies)}, report);
+	}
+
+	// Lets other Python threads run (and, for instance, stop the watch),
+	// while this one is blocked on the library.
+	class allow_threads {
+	public:
+		allow_threads() : state_{PyEval_SaveThread()} {}
+		~allow_threads() { PyEval_RestoreThread(state_); }
+		allow_threads(allow_threads const&) = delete;
+		allow_threads& operator=(allow_threads const&) = delete;
+
+	private:
+		PyThreadState* state_;
+	};
+
+	std::shared_ptr<library_watch> library_watch__init(
+	    movies_config const& cfg,
+	    bool store_updates) {
+		allow_threads nogil{};
+		return std::make_shared<library_watch>(cfg, store_updates);
+	}
+
+	vector<loaded_movie> library_watch__movies(library_watch const& self) {
+		allow_threads nogil{};
+		return self.movies();
+	}
+
+	std::optional<library_delta> library_watch__next_delta(
+	    library_watch& self,
+	    std::chrono::milliseconds timeout) {
+		allow_threads nogil{};
+		return self.next(timeout);
+	}
+
+	object library_watch__wait(library_watch& self, long long timeout_ms) {
+		auto const timeout = std::chrono::milliseconds{timeout_ms};
+		auto delta = library_watch__next_delta(self, timeout);
+		if (!delta) return object{};
+		return object{std::move(*delta)};
+	}
+
+	void library_watch__run(library_watch& self, object callback) {
+		while (auto delta = library_watch__next_delta(
+		           self, std::chrono::milliseconds{-1})) {
+			callback(std::move(*delta));
+		}
+	}
+
+	object library_watch__iter(object self) { return self; }
+
+	library_delta library_watch__next(library_watch& self) {
+		auto delta =
+		    library_watch__next_delta(self, std::chrono::milliseconds{-1});
+		if (!delta) {
+			PyErr_SetNone(PyExc_StopIteration);
+			throw_error_already_set();
+		}
+		return std::move(*delta);
+	}
+
+	std::shared_ptr<library_stream> library_stream__init(
+	    movies_config const& cfg,
+	    bool store_updates) {
+		return std::make_shared<library_stream>(cfg, store_updates);
+	}
+
+	object library_stream__iter(object self) { return self; }
+
+	loaded_movie library_stream__next(library_stream& self) {
+		std::optional<loaded_movie> movie{};
+		{
+			allow_threads nogil{};
+			movie = self.next();
+		}
+		if (!movie) {
+			PyErr_SetNone(PyExc_StopIteration);
+			throw_error_already_set();
+		}
+		return std::move(*movie);
+	}
+
+	std::shared_ptr<language_preference> language_preference__init(
+	    std::string const& lang) {
+		return std::make_shared<language_preference>(lang);
+	}
+
+	std::shared_ptr<language_preference> language_preference__init_list(
+	    list const& langs) {
+		vector<std::string> copy{};
+		auto const length = len(langs);
+		copy.reserve(static_cast<size_t>(length));
+		for (decltype(len(langs)) index = 0; index < length; ++index)
+			copy.push_back(extract<std::string>(langs[index]));
+		return std::make_shared<language_preference>(copy);
+	}
+
+	// Indexes the movies, which have an info file, under its id.
+	std::shared_ptr<title_index> title_index__init(list const& movies) {
+		auto result = std::make_shared<title_index>();
+		auto const length = len(movies);
+		for (decltype(len(movies)) index = 0; index < length; ++index) {
+			loaded_movie const& movie =
+			    extract<loaded_movie const&>(movies[index]);
+			if (!movie.info_file) continue;
+			result->insert(movie.info_file->id, movie);
+		}
+		return result;
+	}
+
+	list title_index__search(title_index const& self,
+	                         std::u8string const& query,
+	                         std::size_t k,
+	                         double min_score) {
+		vector<title_match> matches{};
+		{
+			allow_threads nogil{};
+			matches = self.search(query, k, min_score);
+		}
+
+		list result{};
+		for (auto& match : matches) {
+			result.append(boost::python::make_tuple(object{std::move(match.id)},
+			                                        match.score));
+		}
+		return result;
+	}
+
+	std::shared_ptr<library_table> library_table__init(list const& movies) {
+		auto result = std::make_shared<library_table>();
+		auto const length = len(movies);
+		for (decltype(len(movies)) index = 0; index < length; ++index)
+			result->append(extract<loaded_movie const&>(movies[index]));
+		return result;
+	}
+
+	row_set library_table__between(library_table const& self,
+	                               library_table::number_column which,
+	                               std::uint32_t min,
+	                               std::uint32_t max) {
+		return self.between(which, min, max);
+	}
+
+	row_set library_table__between_dates(library_table const& self,
+	                                     library_table::date_column which,
+	                                     date::sys_seconds from,
+	                                     date::sys_seconds to) {
+		return self.between(which, from, to);
+	}
+
+	list library_table__ids(library_table const& self, row_set const& rows) {
+		auto const ids = self.ids();
+		list result{};
+		for (auto const row : rows.indices()) {
+			if (row < ids.size()) result.append(object{ids[row]});
+		}
+		return result;
+	}
+
+	list row_set__rows(row_set const& self) {
+		list result{};
+		for (auto const row : self.indices())
+			result.append(row);
+		return result;
+	}
+
+	std::shared_ptr<localized_library> localized_library__init(
+	    list const& movies,
+	    language_preference const& langs) {
+		vector<loaded_movie> copy{};
+		auto const length = len(movies);
+		copy.reserve(static_cast<size_t>(length));
+		for (decltype(len(movies)) index = 0; index < length; ++index)
+			copy.push_back(extract<loaded_movie const&>(movies[index]));
+
+		allow_threads nogil{};
+		return std::make_shared<localized_library>(std::move(copy), langs);
+	}
+
+	void localized_library__apply(localized_library& self,
+	                              library_delta const& delta) {
+		allow_threads nogil{};
+		self.apply(delta);
+	}
+
+	void localized_library__set_languages(localized_library& self,
+	                                      language_preference const& langs) {
+		allow_threads nogil{};
+		self.set_languages(langs);
+	}
+
+	void localized_library__check(localized_library const& self,
+	                              std::size_t row) {
+		if (row < self.size()) return;
+		PyErr_SetString(PyExc_IndexError, "row out of range");
+		throw_error_already_set();
+	}
+
+	std::optional<std::size_t> localized_library__find(
+	    localized_library const& self,
+	    std::u8string const& id) {
+		return self.find(id);
+	}
+
+	loaded_movie localized_library__movie(localized_library const& self,
+	                                      std::size_t row) {
+		localized_library__check(self, row);
+		return self.movies()[row];
+	}
+
+	template <typename Value>
+	std::optional<Value> optional_copy(Value const* value) {
+		if (!value) return std::nullopt;
+		return *value;
+	}
+
+#define X_FIELD_GETTER(NAME)                                      \
+	auto localized_library__##NAME(localized_library const& self, \
+	                               std::size_t row) {             \
+		localized_library__check(self, row);                      \
+		return optional_copy(self.NAME(row));                     \
+	}
+	LOCALIZED_FIELD_X(X_FIELD_GETTER)
+#undef X_FIELD_GETTER
+
+	std::shared_ptr<tag_index> tag_index__init(list const& movies) {
+		auto result = std::make_shared<tag_index>();
+		auto const length = len(movies);
+		for (decltype(len(movies)) index = 0; index < length; ++index) {
+			loaded_movie const& movie =
+			    extract<loaded_movie const&>(movies[index]);
+			result->insert(movie.get_id(), movie);
+		}
+		return result;
+	}
+
+	vector<std::u8string> tag_index__values(list const& values) {
+		vector<std::u8string> result{};
+		auto const length = len(values);
+		result.reserve(static_cast<size_t>(length));
+		for (decltype(len(values)) index = 0; index < length; ++index)
+			result.push_back(extract<std::u8string>(values[index]));
+		return result;
+	}
+
+	std::size_t tag_index__count(tag_index const& self,
+	                             tag_index::list_column which,
+	                             std::u8string const& value) {
+		return self.count(which, value);
+	}
+
+	row_set tag_index__has(tag_index const& self,
+	                       tag_index::list_column which,
+	                       std::u8string const& value) {
+		return self.has(which, value);
+	}
+
+#define X_SET_QUERY(NAME)                                   \
+	row_set tag_index__##NAME(tag_index const& self,        \
+	                          tag_index::list_column which, \
+	                          list const& values) {         \
+		return self.NAME(which, tag_index__values(values)); \
+	}
+	X_SET_QUERY(any_of)
+	X_SET_QUERY(all_of)
+	X_SET_QUERY(none_of)
+#undef X_SET_QUERY
+
+	list tag_index__ids(tag_index const& self, row_set const& rows) {
+		list result{};
+		for (auto const& id : self.ids(rows))
+			result.append(object{id});
+		return result;
+	}
+
 	json::node simpler(json::node value, int level);
 	struct simplifier {
 		int level;
@@ -304,6 +627,113 @@ BOOST_PYTHON_MODULE(movies) {
 		        ;
 	}
 
+	class_<library_delta>("library_delta")
+	    .add_property("added", make_getter(&library_delta::added))
+	    .add_property("changed", make_getter(&library_delta::changed))
+	    .add_property("removed", make_getter(&library_delta::removed))
+	    .def("empty", &library_delta::empty);
+
+	class_<library_watch, std::shared_ptr<library_watch>, boost::noncopyable>(
+	    "library_watch", no_init)
+	    .def("__init__", make_constructor(library_watch__init))
+	    .def("movies", library_watch__movies)
+	    .def("wait", library_watch__wait)
+	    .def("run", library_watch__run)
+	    .def("stop", &library_watch::stop)
+	    .def("stopped", &library_watch::stopped)
+	    .def("__iter__", library_watch__iter)
+	    .def("__next__", library_watch__next);
+
+	class_<library_stream, std::shared_ptr<library_stream>, boost::noncopyable>(
+	    "library_stream", no_init)
+	    .def("__init__", make_constructor(library_stream__init))
+	    .def("__iter__", library_stream__iter)
+	    .def("__next__", library_stream__next);
+
+	class_<language_preference, std::shared_ptr<language_preference>>(
+	    "language_preference", no_init)
+	    .def("__init__", make_constructor(language_preference__init))
+	    .def("__init__", make_constructor(language_preference__init_list));
+
+	class_<localized_library, std::shared_ptr<localized_library>,
+	       boost::noncopyable>("localized_library", no_init)
+	    .def("__init__", make_constructor(localized_library__init))
+	    .def("__len__", &localized_library::size)
+	    .def("apply", localized_library__apply)
+	    .def("set_languages", localized_library__set_languages)
+	    .def("find", localized_library__find)
+	    .def("movie", localized_library__movie)
+#define X_FIELD_DEF(NAME) .def(#NAME, localized_library__##NAME)
+	        LOCALIZED_FIELD_X(X_FIELD_DEF)
+#undef X_FIELD_DEF
+	        ;
+
+	class_<title_index, std::shared_ptr<title_index>, boost::noncopyable>(
+	    "title_index", no_init)
+	    .def("__init__", make_constructor(title_index__init))
+	    .def("insert", &title_index::insert)
+	    .def("remove", &title_index::remove)
+	    .def("search", title_index__search,
+	         (arg("self"), arg("query"), arg("k") = 5, arg("min_score") = 0.8))
+	    .def("__len__", &title_index::size)
+	    .def("__contains__", &title_index::contains);
+
+	class_<tag_index, std::shared_ptr<tag_index>, boost::noncopyable>(
+	    "tag_index", no_init)
+	    .def("__init__", make_constructor(tag_index__init))
+	    .def("insert", &tag_index::insert)
+	    .def("remove", &tag_index::remove)
+	    .def("apply", &tag_index::apply)
+	    .def("__len__", &tag_index::size)
+	    .def("__contains__", &tag_index::contains)
+	    .def("count", tag_index__count)
+	    .def("all", &tag_index::all)
+	    .def("has", tag_index__has)
+	    .def("any_of", tag_index__any_of)
+	    .def("all_of", tag_index__all_of)
+	    .def("none_of", tag_index__none_of)
+	    .def("ids", tag_index__ids);
+
+	class_<row_set>("row_set")
+	    .def("__len__", &row_set::count)
+	    .def("__contains__", &row_set::contains)
+	    .def(self & self)
+	    .def(self | self)
+	    .def(~self)
+	    .def("rows", row_set__rows);
+
+	{
+		auto outer = scope{
+		    class_<library_table, std::shared_ptr<library_table>,
+		           boost::noncopyable>("library_table", no_init)
+		        .def("__init__", make_constructor(library_table__init))
+		        .def("__len__", &library_table::size)
+		        .def("all", &library_table::all)
+		        .def("between", library_table__between)
+		        .def("between_dates", library_table__between_dates)
+		        .def("media_type", &library_table::is)
+		        .def("has", &library_table::has)
+		        .def("ids", library_table__ids)};
+
+		enum_<library_table::number_column>("number_column")
+#define X_VALUE(NAME) .value(#NAME, library_table::number_column::NAME)
+		    LIBRARY_NUMBER_COLUMN_X(X_VALUE)
+#undef X_VALUE
+		        ;
+
+		enum_<library_table::date_column>("date_column")
+#define X_VALUE(NAME) .value(#NAME, library_table::date_column::NAME)
+		    LIBRARY_DATE_COLUMN_X(X_VALUE)
+#undef X_VALUE
+		        ;
+
+		enum_<library_table::list_column>("list_column")
+#define X_VALUE(NAME) .value(#NAME, library_table::list_column::NAME)
+		    LIBRARY_LIST_COLUMN_X(X_VALUE)
+#undef X_VALUE
+		        ;
+	}
+
 	{
 		scope current;
 		api::setattr(current, "version", movies::VERSION);
@@ -0,0 +1,63 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#include "similarity.hpp"
+#include <algorithm>
+#include <bit>
+
+namespace movies::similarity {
+	namespace {
+		constexpr std::size_t bits = 64;
+	}  // namespace
+
+	lcs_pattern::lcs_pattern(std::u8string_view pattern)
+	    : size_{pattern.size()}
+	    , words_{(std::max)(std::size_t{1}, (pattern.size() + bits - 1) / bits)}
+	    , last_mask_{~std::uint64_t{}}
+	    , masks_(256 * words_) {
+		auto const last_bits = pattern.size() - (words_ - 1) * bits;
+		if (last_bits < bits) last_mask_ = (std::uint64_t{1} << last_bits) - 1;
+
+		for (std::size_t pos = 0; pos < pattern.size(); ++pos) {
+			auto const c = static_cast<unsigned char>(pattern[pos]);
+			masks_[c * words_ + pos / bits] |= std::uint64_t{1} << (pos % bits);
+		}
+	}
+
+	std::size_t lcs_pattern::length(std::u8string_view text) const {
+		if (words_ == 1) {
+			auto v = ~std::uint64_t{};
+			for (auto const c : text) {
+				auto const u = v & *masks_of(static_cast<unsigned char>(c));
+				v = (v + u) | (v - u);
+			}
+			return static_cast<std::size_t>(std::popcount(~v & last_mask_));
+		}
+
+		// the same, with the carry of the addition moving up the words
+		std::vector<std::uint64_t> v(words_, ~std::uint64_t{});
+		for (auto const c : text) {
+			auto const masks = masks_of(static_cast<unsigned char>(c));
+			std::uint64_t carry = 0;
+			for (std::size_t word = 0; word < words_; ++word) {
+				auto const u = v[word] & masks[word];
+				auto const partial = v[word] + u;
+				auto const sum = partial + carry;
+				carry = (partial < v[word]) || (sum < partial) ? 1 : 0;
+				v[word] = sum | (v[word] - u);
+			}
+		}
+
+		std::size_t result = 0;
+		for (std::size_t word = 0; word + 1 < words_; ++word)
+			result += static_cast<std::size_t>(std::popcount(~v[word]));
+		return result + static_cast<std::size_t>(
+		                    std::popcount(~v.back() & last_mask_));
+	}
+
+	void lcs_pattern::lengths(std::span<std::u8string_view const> texts,
+	                          std::span<std::size_t> result) const {
+		for (std::size_t index = 0; index < texts.size(); ++index)
+			result[index] = length(texts[index]);
+	}
+}  // namespace movies::similarity
@@ -0,0 +1,50 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace movies::similarity {
+	// The arithmetic of difflib's ratio(), so a ratio computed here and
+	// the one from the SequenceMatcher compare exactly.
+	inline double ratio_of(std::size_t matches, std::size_t length) noexcept {
+		if (length == 0) return 1.0;
+		return 2. * matches / length;
+	}
+
+	// Length of the longest common subsequence of one pattern and many
+	// texts, with the bit-parallel algorithm of Allison and Dix (as
+	// described by Hyyrö): one bit of state per pattern byte, a handful
+	// of word operations per text byte. As the matching blocks of the
+	// SequenceMatcher are a common subsequence, the LCS ratio is never
+	// below difflib's ratio().
+	class lcs_pattern {
+	public:
+		explicit lcs_pattern(std::u8string_view pattern);
+
+		std::size_t size() const noexcept { return size_; }
+
+		std::size_t length(std::u8string_view text) const;
+
+		// length() of each of the texts.
+		void lengths(std::span<std::u8string_view const> texts,
+		             std::span<std::size_t> result) const;
+
+	private:
+		std::uint64_t const* masks_of(unsigned char c) const noexcept {
+			return masks_.data() + c * words_;
+		}
+
+		std::size_t size_;
+		std::size_t words_;
+		// the bits of the last word, which belong to the pattern
+		std::uint64_t last_mask_;
+		// words_ masks for each of 256 bytes
+		std::vector<std::uint64_t> masks_;
+	};
+}  // namespace movies::similarity
@@ -0,0 +1,237 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#include <algorithm>
+#include <io/file.hpp>
+#include <io/walk.hpp>
+#include <movies/binary.hpp>
+#include <movies/load_stats.hpp>
+#include <movies/manifest.hpp>
+#include <movies/movie_info.hpp>
+
+using namespace std::literals;
+
+// Layout of a snapshot file:
+//
+//    magic          8 bytes, "MOVIESNP"
+//    version        uint32
+//    byte order     uint32, 0x01020304 as written by the producer
+//    schema         uint64, BINARY_SCHEMA
+//    directories    uint64, digest of the state of movies_dirs
+//    flags          uint8, SNAPSHOT_UPDATES_STORED
+//    count          LEB128
+//    movies         count x (movie_info, file_ref? video, file_ref? info)
+//
+// Any mismatch in the header means the snapshot is simply ignored, there is
+// nothing to migrate in a cache.
+
+namespace movies {
+	namespace {
+		static constexpr char SNAPSHOT_MAGIC[8] = {'M', 'O', 'V', 'I',
+		                                           'E', 'S', 'N', 'P'};
+		static constexpr std::uint32_t SNAPSHOT_VERSION = 1;
+		static constexpr std::uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+		static constexpr std::uint8_t SNAPSHOT_UPDATES_STORED = 0x01;
+
+		struct fnv1a {
+			std::uint64_t value{14695981039346656037ull};
+
+			void add(void const* data, size_t size) noexcept {
+				auto const bytes = static_cast<unsigned char const*>(data);
+				for (size_t index = 0; index < size; ++index) {
+					value ^= bytes[index];
+					value *= 1099511628211ull;
+				}
+			}
+
+			void add(std::u8string_view str) noexcept {
+				auto const size = str.size();
+				add(&size, sizeof(size));
+				add(str.data(), str.size());
+			}
+
+			void add(file_stat const& stat) noexcept {
+				add(&stat.size, sizeof(stat.size));
+				add(&stat.mtime, sizeof(stat.mtime));
+			}
+		};
+
+		using stat_list = std::vector<std::pair<fs_string, file_stat>>;
+
+		stat_list scan_dir(fs::path const& root,
+		                   std::span<std::u8string_view const> extensions) {
+			stat_list result{};
+
+			io::walk(root, extensions, true, [&](io::walk_entry const& entry) {
+				auto const mtime = entry.mtime.time_since_epoch().count();
+				result.push_back({fs_string{entry.path}, {entry.size, mtime}});
+			});
+
+			std::sort(result.begin(), result.end(),
+			          [](auto const& lhs, auto const& rhs) {
+				          return lhs.first < rhs.first;
+			          });
+			return result;
+		}
+
+		// Everything load() looks at: the directories themselves, every
+		// info and video file there is and the aliases used to
+		// post-process the infos.
+		std::uint64_t directory_digest(movies_dirs const& dirs) {
+			static constexpr std::u8string_view info_exts[] = {u8".json"sv};
+			static constexpr std::u8string_view video_exts[] = {u8".mp4"sv,
+			                                                    u8".mkv"sv};
+			auto const infos = scan_dir(dirs.infos, info_exts);
+			auto const videos = scan_dir(dirs.videos, video_exts);
+
+			fnv1a digest{};
+			digest.add(dirs.infos.generic_u8string());
+			digest.add(dirs.videos.generic_u8string());
+			digest.add(
+			    file_stat::of(dirs.infos / ".."sv / "iso-alpha-2.json"sv));
+			for (auto const* list : {&infos, &videos}) {
+				auto const size = list->size();
+				digest.add(&size, sizeof(size));
+				for (auto const& [path, stat] : *list) {
+					digest.add(path);
+					digest.add(stat);
+				}
+			}
+			return digest.value;
+		}
+
+		void write_ref(binary_writer& out, std::optional<file_ref> const& ref) {
+			to_binary(out, ref.has_value());
+			if (!ref) return;
+			to_binary(out, ref->id);
+			to_binary(out, ref->mtime);
+		}
+
+		bool read_ref(binary_reader& in, std::optional<file_ref>& ref) {
+			bool has_value{};
+			if (!from_binary(in, has_value)) return false;
+			if (!has_value) {
+				ref = std::nullopt;
+				return true;
+			}
+			ref.emplace();
+			return from_binary(in, ref->id) && from_binary(in, ref->mtime);
+		}
+
+		template <typename Header>
+		bool read_header(binary_reader& in, Header const& expected) {
+			Header actual{};
+			return from_binary(in, actual) && actual == expected;
+		}
+
+		bool write_snapshot(fs::path const& filename,
+		                    vector<loaded_movie> const& movies,
+		                    std::uint64_t digest,
+		                    bool updates_stored) {
+			binary_writer out{};
+			out.write(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+			to_binary(out, SNAPSHOT_VERSION);
+			to_binary(out, SNAPSHOT_BYTE_ORDER);
+			to_binary(out, BINARY_SCHEMA);
+			to_binary(out, digest);
+			to_binary(out, static_cast<std::uint8_t>(
+			                   updates_stored ? SNAPSHOT_UPDATES_STORED : 0));
+			out.write_size(movies.size());
+			for (auto const& movie : movies) {
+				static_cast<movie_info const&>(movie).to_binary(out);
+				write_ref(out, movie.video_file);
+				write_ref(out, movie.info_file);
+			}
+
+			// a reader must never see half of a snapshot
+			return io::replace_contents(filename, out.bytes());
+		}
+
+		std::optional<vector<loaded_movie>> read_snapshot(
+		    fs::path const& filename,
+		    std::uint64_t digest,
+		    bool store_updates) {
+			auto const data = io::mapped_file::open(filename);
+			if (!data) return std::nullopt;
+
+			binary_reader in{data.view()};
+			char magic[sizeof(SNAPSHOT_MAGIC)]{};
+			std::uint8_t flags{};
+			if (!in.read(magic, sizeof(magic)) ||
+			    !std::equal(std::begin(magic), std::end(magic),
+			                std::begin(SNAPSHOT_MAGIC)) ||
+			    !read_header(in, SNAPSHOT_VERSION) ||
+			    !read_header(in, SNAPSHOT_BYTE_ORDER) ||
+			    !read_header(in, BINARY_SCHEMA) ||
+			    !read_header(in, digest) || !from_binary(in, flags))
+				return std::nullopt;
+
+			// a snapshot made without store_updates may hide infos, which
+			// would be rewritten by a load with store_updates
+			if (store_updates && !(flags & SNAPSHOT_UPDATES_STORED))
+				return std::nullopt;
+
+			size_t count{};
+			if (!in.read_size(count) || count > in.remaining())
+				return std::nullopt;
+
+			vector<loaded_movie> movies(count);
+			for (auto& movie : movies) {
+				if (!static_cast<movie_info&>(movie).from_binary(in) ||
+				    !read_ref(in, movie.video_file) ||
+				    !read_ref(in, movie.info_file))
+					return std::nullopt;
+			}
+			if (in.remaining()) return std::nullopt;
+
+			return movies;
+		}
+	}  // namespace
+
+	std::optional<vector<loaded_movie>> movies_config::open_snapshot(
+	    fs::path const& snapshot,
+	    bool store_updates) const {
+		if (!fs::exists(snapshot)) return std::nullopt;
+		return read_snapshot(snapshot, directory_digest(dirs), store_updates);
+	}
+
+	// Hashes the directories now, so anything changed there since the
+	// movies were loaded goes unnoticed; the overload taking the digest
+	// from before the load does not have that problem.
+	bool movies_config::save_snapshot(fs::path const& snapshot,
+	                                  vector<loaded_movie> const& movies,
+	                                  bool updates_stored) const {
+		return write_snapshot(snapshot, movies, directory_digest(dirs),
+		                      updates_stored);
+	}
+
+	bool movies_config::save_snapshot(fs::path const& snapshot,
+	                                  vector<loaded_movie> const& movies,
+	                                  bool updates_stored,
+	                                  std::uint64_t digest) const {
+		return write_snapshot(snapshot, movies, digest, updates_stored);
+	}
+
+	std::uint64_t movies_config::snapshot_digest() const {
+		return directory_digest(dirs);
+	}
+
+	vector<loaded_movie> movies_config::load_with_snapshot(
+	    fs::path const& snapshot,
+	    bool store_updates) const {
+		// taken before the load, so a file changed while it runs makes
+		// the snapshot stale, instead of hiding the change
+		auto const digest = directory_digest(dirs);
+		if (auto movies = read_snapshot(snapshot, digest, store_updates))
+			return std::move(*movies);
+
+		load_stats stats{};
+		auto movies = load(store_updates, stats);
+		// the updates stored by this load changed the infos under the
+		// digest; the next load will have nothing to store and will write
+		// the snapshot then
+		if (!stats.stored_infos)
+			write_snapshot(snapshot, movies, digest, store_updates);
+		return movies;
+	}
+}  // namespace movies
@@ -0,0 +1,65 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#include <atomic>
+#include <movies/stream.hpp>
+#include <utility>
+#include "library.hpp"
+#include "parallel.hpp"
+
+namespace movies {
+	struct library_stream::impl {
+		work_queue<loaded_movie> queue{};
+		// raised, once nobody is listening anymore, to get the loader out
+		// of the walks and the differ early
+		stop_flag abandoned{false};
+		std::exception_ptr error{};
+		std::thread loader{};
+
+		impl(movies_config const& cfg, bool store_updates) {
+			loader = std::thread{[this, cfg, store_updates] {
+				auto const sink = [this](loaded_movie&& movie) {
+					throw_if_stopped(&abandoned);
+					queue.push(std::move(movie));
+				};
+				try {
+					stream_library(cfg, store_updates, nullptr, sink, true,
+					               movie_info_fields::all, nullptr, &abandoned);
+				} catch (load_stopped const&) {
+				} catch (...) {
+					// written before close(), read after pop() fails
+					error = std::current_exception();
+				}
+				queue.close();
+			}};
+		}
+
+		~impl() {
+			abandoned = true;
+			if (loader.joinable()) loader.join();
+		}
+
+		std::optional<loaded_movie> next() {
+			loaded_movie movie{};
+			if (queue.pop(movie)) return movie;
+			if (error) std::rethrow_exception(std::exchange(error, nullptr));
+			return std::nullopt;
+		}
+	};
+
+	library_stream::library_stream(movies_config const& cfg,
+	                               bool store_updates)
+	    : impl_{std::make_unique<impl>(cfg, store_updates)} {}
+	library_stream::~library_stream() = default;
+	library_stream::library_stream(library_stream&&) noexcept = default;
+	library_stream& library_stream::operator=(library_stream&&) noexcept =
+	    default;
+
+	std::optional<loaded_movie> library_stream::next() {
+		return impl_->next();
+	}
+
+	library_stream movies_config::stream(bool store_updates) const {
+		return library_stream{*this, store_updates};
+	}
+}  // namespace movies
@@ -0,0 +1,211 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#include <algorithm>
+#include <iterator>
+#include <movies/tag_index.hpp>
+
+namespace movies {
+	namespace {
+		// in the order of library_table::list_column
+		constexpr std::vector<interned_string> movie_info::*lists[] = {
+		    &movie_info::genres,
+		    &movie_info::countries,
+		    &movie_info::tags,
+		};
+
+		std::vector<interned_string> const& values_of(movie_info const& info,
+		                                              std::size_t column) {
+			return info.*lists[column];
+		}
+
+		bool contains_value(std::vector<interned_string> const& values,
+		                    interned_string const& value) {
+			return std::find(values.begin(), values.end(), value) !=
+			       values.end();
+		}
+	}  // namespace
+
+	tag_index::tag_index(std::vector<loaded_movie> const& movies) {
+		documents_.reserve(movies.size());
+		by_id_.reserve(movies.size());
+		for (auto const& movie : movies)
+			insert(movie.get_id(), movie);
+	}
+
+	void tag_index::insert(string_type const& id, movie_info const& info) {
+		auto it = by_id_.find(id);
+		if (it == by_id_.end()) {
+			document_id doc{};
+			if (!free_.empty()) {
+				doc = free_.back();
+				free_.pop_back();
+			} else {
+				doc = static_cast<document_id>(documents_.size());
+				documents_.emplace_back();
+			}
+			documents_[doc].id = id;
+			documents_[doc].live = true;
+			it = by_id_.emplace(id, doc).first;
+		}
+
+		auto const doc = it->second;
+		for (std::size_t column = 0; column < list_columns; ++column) {
+			auto const& next = values_of(info, column);
+			auto& prev = documents_[doc].values[column];
+			// the values are interned, so these are pointer compares
+			if (prev == next) continue;
+
+			for (auto const& value : prev) {
+				if (!contains_value(next, value)) unlink(column, value, doc);
+			}
+			for (auto const& value : next) {
+				if (!contains_value(prev, value)) link(column, value, doc);
+			}
+			prev = next;
+		}
+	}
+
+	bool tag_index::remove(string_type const& id) {
+		auto it = by_id_.find(id);
+		if (it == by_id_.end()) return false;
+
+		auto const doc = it->second;
+		auto& document = documents_[doc];
+		for (std::size_t column = 0; column < list_columns; ++column) {
+			for (auto const& value : document.values[column])
+				unlink(column, value, doc);
+		}
+		document = {};
+		free_.push_back(doc);
+		by_id_.erase(it);
+		return true;
+	}
+
+	void tag_index::apply(library_delta const& delta) {
+		for (auto const& id : delta.removed)
+			remove(id);
+		for (auto const* list : {&delta.added, &delta.changed}) {
+			for (auto const& movie : *list)
+				insert(movie.get_id(), movie);
+		}
+	}
+
+	bool tag_index::contains(string_type const& id) const {
+		return by_id_.contains(id);
+	}
+
+	std::size_t tag_index::count(list_column which,
+	                             string_view_type value) const {
+		auto const list = postings_of(which, value);
+		return list ? list->size() : 0;
+	}
+
+	row_set tag_index::all() const {
+		row_set result{documents_.size(), false};
+		for (std::size_t doc = 0; doc < documents_.size(); ++doc) {
+			if (documents_[doc].live) result.insert(doc);
+		}
+		return result;
+	}
+
+	row_set tag_index::has(list_column which, string_view_type value) const {
+		row_set result{documents_.size(), false};
+		if (auto const list = postings_of(which, value)) {
+			for (auto const doc : *list)
+				result.insert(doc);
+		}
+		return result;
+	}
+
+	row_set tag_index::any_of(list_column which,
+	                          std::span<string_type const> values) const {
+		row_set result{documents_.size(), false};
+		for (auto const& value : values) {
+			if (auto const list = postings_of(which, value)) {
+				for (auto const doc : *list)
+					result.insert(doc);
+			}
+		}
+		return result;
+	}
+
+	row_set tag_index::all_of(list_column which,
+	                          std::span<string_type const> values) const {
+		if (values.empty()) return all();
+
+		std::vector<postings const*> lists{};
+		lists.reserve(values.size());
+		for (auto const& value : values) {
+			auto const list = postings_of(which, value);
+			if (!list) return {documents_.size(), false};
+			lists.push_back(list);
+		}
+
+		// the shortest list bounds the result; start from it
+		std::sort(lists.begin(), lists.end(),
+		          [](postings const* lhs, postings const* rhs) {
+			          return lhs->size() < rhs->size();
+		          });
+		postings common{*lists.front()};
+		postings next{};
+		for (auto index = 1u; index < lists.size() && !common.empty();
+		     ++index) {
+			next.clear();
+			std::set_intersection(common.begin(), common.end(),
+			                      lists[index]->begin(), lists[index]->end(),
+			                      std::back_inserter(next));
+			std::swap(common, next);
+		}
+
+		row_set result{documents_.size(), false};
+		for (auto const doc : common)
+			result.insert(doc);
+		return result;
+	}
+
+	row_set tag_index::none_of(list_column which,
+	                           std::span<string_type const> values) const {
+		return all() & ~any_of(which, values);
+	}
+
+	std::vector<string_type> tag_index::ids(row_set const& rows) const {
+		std::vector<string_type> result{};
+		result.reserve(rows.count());
+		for (auto const row : rows.indices()) {
+			if (row < documents_.size() && documents_[row].live)
+				result.push_back(documents_[row].id);
+		}
+		return result;
+	}
+
+	tag_index::postings const* tag_index::postings_of(
+	    list_column which,
+	    string_view_type value) const {
+		auto const& column = postings_[static_cast<std::size_t>(which)];
+		auto it = column.find(value);
+		if (it == column.end()) return nullptr;
+		return &it->second;
+	}
+
+	void tag_index::link(std::size_t column,
+	                     interned_string const& value,
+	                     document_id doc) {
+		auto& list = postings_[column][string_view_type{value}];
+		auto it = std::lower_bound(list.begin(), list.end(), doc);
+		if (it == list.end() || *it != doc) list.insert(it, doc);
+	}
+
+	void tag_index::unlink(std::size_t column,
+	                       interned_string const& value,
+	                       document_id doc) {
+		auto& values = postings_[column];
+		auto it = values.find(string_view_type{value});
+		if (it == values.end()) return;
+
+		auto& list = it->second;
+		auto pos = std::lower_bound(list.begin(), list.end(), doc);
+		if (pos != list.end() && *pos == doc) list.erase(pos);
+		if (list.empty()) values.erase(it);
+	}
+}  // namespace movies
@@ -0,0 +1,176 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#include <movies/title_index.hpp>
+#include <optional>
+#include <unordered_map>
+#include "fuzzy.hpp"
+
+namespace movies {
+	namespace {
+		bool better(title_match const& lhs, title_match const& rhs) {
+			if (lhs.score != rhs.score) return lhs.score > rhs.score;
+			return lhs.id < rhs.id;
+		}
+	}  // namespace
+
+	struct title_index::impl {
+		struct entry {
+			std::u8string id{};
+			// the normalized id and titles; empty, once removed
+			std::vector<std::u8string> keys{};
+			bool alive{true};
+		};
+
+		std::vector<entry> entries{};
+		std::unordered_map<std::u8string, size_t> owners{};
+		fuzzy::posting_index postings{};
+		size_t dead_strings{};
+
+		void insert(std::u8string const& id, movie_info const& info) {
+			remove(id);
+
+			entry item{.id = id};
+			fuzzy::for_each_key(
+			    id, info, [&](std::u8string_view text, auto normalize) {
+				    std::u8string key{text};
+				    normalize(std::span{key});
+				    item.keys.push_back(std::move(key));
+			    });
+
+			auto const owner = entries.size();
+			entries.push_back(std::move(item));
+			owners[id] = owner;
+			index(owner);
+		}
+
+		bool remove(std::u8string const& id) {
+			auto it = owners.find(id);
+			if (it == owners.end()) return false;
+
+			auto& item = entries[it->second];
+			dead_strings += item.keys.size();
+			item.keys.clear();
+			item.alive = false;
+			owners.erase(it);
+
+			// the postings of the removed ids are only skipped over, until
+			// they are the majority
+			if (dead_strings * 2 > postings.strings()) rebuild();
+			return true;
+		}
+
+		vector<title_match> search(std::u8string_view query,
+		                           size_t k,
+		                           double min_score) const {
+			vector<title_match> heap{};
+			if (!k) return heap;
+
+			std::u8string key{query};
+			fuzzy::spaced(std::span{key});
+
+			similarity::lcs_pattern const pattern{key};
+			std::optional<fuzzy::matcher> similar{};
+
+			// one scratch per searching thread, grown to the largest index
+			// it has seen, so a search allocates nothing per entry
+			thread_local fuzzy::posting_index::query scratch{};
+			for (auto const owner :
+			     scratch.candidates(postings, key, min_score)) {
+				if (!entries[owner].alive) continue;
+
+				// nothing below the worst of the best k can get in
+				auto floor = min_score;
+				if (heap.size() == k)
+					floor = (std::max)(floor, heap.front().score);
+
+				std::optional<double> best{};
+				for (auto const& text : entries[owner].keys) {
+					auto const bar = best ? (std::max)(floor, *best) : floor;
+					auto const length = text.size() + key.size();
+					if (fuzzy::length_bound(text, key) < bar) continue;
+					if (similarity::ratio_of(pattern.length(text), length) <
+					    bar)
+						continue;
+
+					if (!similar) similar.emplace(std::u8string_view{}, key);
+					similar->set_seq1(text);
+					auto const score = similarity::ratio_of(
+					    fuzzy::matches_of(*similar), length);
+					if (!best || score > *best) best = score;
+				}
+				if (!best || *best < floor) continue;
+
+				title_match match{entries[owner].id, *best};
+				if (heap.size() == k) {
+					if (!better(match, heap.front())) continue;
+					std::pop_heap(heap.begin(), heap.end(), better);
+					heap.pop_back();
+				}
+				heap.push_back(std::move(match));
+				std::push_heap(heap.begin(), heap.end(), better);
+			}
+
+			std::sort(heap.begin(), heap.end(), better);
+			return heap;
+		}
+
+	private:
+		void index(size_t owner) {
+			for (auto const& text : entries[owner].keys)
+				postings.add(owner, text);
+		}
+
+		void rebuild() {
+			std::vector<entry> alive{};
+			alive.reserve(owners.size());
+			for (auto& item : entries) {
+				if (item.alive) alive.push_back(std::move(item));
+			}
+
+			entries = std::move(alive);
+			owners.clear();
+			postings.clear();
+			dead_strings = 0;
+
+			for (size_t owner = 0; owner < entries.size(); ++owner) {
+				owners[entries[owner].id] = owner;
+				index(owner);
+			}
+		}
+	};
+
+	title_index::title_index() : impl_{std::make_unique<impl>()} {}
+
+	title_index::title_index(map<std::u8string, movie_info> const& infos)
+	    : title_index{} {
+		for (auto const& [id, info] : infos)
+			impl_->insert(id, info);
+	}
+
+	title_index::~title_index() = default;
+	title_index::title_index(title_index&&) noexcept = default;
+	title_index& title_index::operator=(title_index&&) noexcept = default;
+
+	void title_index::insert(std::u8string const& id, movie_info const& info) {
+		impl_->insert(id, info);
+	}
+
+	bool title_index::remove(std::u8string const& id) {
+		return impl_->remove(id);
+	}
+
+	std::size_t title_index::size() const noexcept {
+		return impl_->owners.size();
+	}
+
+	bool title_index::contains(std::u8string const& id) const {
+		return impl_->owners.contains(id);
+	}
+
+	vector<title_match> title_index::search(std::u8string_view query,
+	                                        std::size_t k,
+	                                        double min_score) const {
+		return impl_->search(query, k, min_score);
+	}
+}  // namespace movies
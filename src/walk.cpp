@@ -0,0 +1,223 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#include <algorithm>
+#include <io/walk.hpp>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <system_error>
+#endif
+
+using namespace std::literals;
+
+namespace io {
+	namespace {
+		std::u8string_view extension_of(std::u8string_view filename) {
+			auto const pos = filename.rfind(u8'.');
+			if (pos == std::u8string_view::npos || pos == 0) return {};
+			return filename.substr(pos);
+		}
+
+		bool accepts(std::span<std::u8string_view const> extensions,
+		             std::u8string_view ext) {
+			return extensions.empty() ||
+			       std::find(extensions.begin(), extensions.end(), ext) !=
+			           extensions.end();
+		}
+
+#if defined(__linux__)
+		struct linux_dirent64 {
+			ino64_t d_ino;
+			off64_t d_off;
+			unsigned short d_reclen;
+			unsigned char d_type;
+			char d_name[];
+		};
+
+		fs::file_time_type file_time(struct timespec const& time) {
+			using namespace std::chrono;
+			auto const since_epoch =
+			    seconds{time.tv_sec} + nanoseconds{time.tv_nsec};
+			return fs::file_time_type::clock::from_sys(
+			    sys_time<nanoseconds>{since_epoch});
+		}
+
+		class descriptor {
+		public:
+			explicit descriptor(int fd) noexcept : fd_{fd} {}
+			descriptor(descriptor const&) = delete;
+			descriptor& operator=(descriptor const&) = delete;
+			~descriptor() { ::close(fd_); }
+
+			int get() const noexcept { return fd_; }
+
+		private:
+			int fd_;
+		};
+
+		class walker {
+		public:
+			walker(std::span<std::u8string_view const> extensions,
+			       bool with_stat,
+			       walk_visitor const& visitor)
+			    : extensions_{extensions}
+			    , with_stat_{with_stat}
+			    , visitor_{visitor} {}
+
+			// Takes over the descriptor. Throws, if a directory could not
+			// be read to the end, or a sub-directory could not be opened;
+			// a partial listing would look like removed files to anyone
+			// comparing it with an older one.
+			void visit(int fd) {
+				descriptor const dir{fd};
+				std::vector<std::string> subdirs{};
+
+				while (true) {
+					auto const length =
+					    ::syscall(SYS_getdents64, dir.get(), buffer_.data(),
+					              buffer_.size());
+					if (length == 0) break;
+					if (length < 0) {
+						if (errno == EINTR) continue;
+						fail("getdents64", {});
+					}
+
+					for (long offset = 0; offset < length;) {
+						auto const& dirent =
+						    *reinterpret_cast<linux_dirent64 const*>(
+						        buffer_.data() + offset);
+						offset += dirent.d_reclen;
+						on_entry(dir.get(), dirent, subdirs);
+					}
+				}
+
+				// the names are only collected above, so there is one
+				// read buffer and one open descriptor per level at most
+				auto const prefix_length = path_.size();
+				for (auto const& name : subdirs) {
+					int subdir{};
+					do {
+						subdir = ::openat(
+						    dir.get(), name.c_str(),
+						    O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+					} while (subdir < 0 && errno == EINTR);
+					if (subdir < 0) fail("openat", name);
+					path_.append(name.begin(), name.end());
+					path_.push_back(u8'/');
+					visit(subdir);
+					path_.resize(prefix_length);
+				}
+			}
+
+		private:
+			[[noreturn]] void fail(char const* call, std::string_view name) {
+				auto const error = errno;
+				std::string where{call};
+				where.append(": "sv);
+				where.append(reinterpret_cast<char const*>(path_.data()),
+				             path_.size());
+				where.append(name);
+				throw std::system_error{error, std::generic_category(), where};
+			}
+
+			void on_entry(int dirfd,
+			              linux_dirent64 const& dirent,
+			              std::vector<std::string>& subdirs) {
+				std::string_view const name{dirent.d_name};
+				if (name == "."sv || name == ".."sv) return;
+
+				struct stat st {};
+				bool has_stat = false;
+				auto type = dirent.d_type;
+				auto const is_link = type == DT_LNK;
+				if (type == DT_UNKNOWN || is_link) {
+					if (::fstatat(dirfd, dirent.d_name, &st, 0)) return;
+					has_stat = true;
+					type = S_ISDIR(st.st_mode) ? DT_DIR : DT_REG;
+				}
+
+				if (type == DT_DIR) {
+					if (!is_link) subdirs.emplace_back(name);
+					return;
+				}
+
+				std::u8string_view const filename{
+				    reinterpret_cast<char8_t const*>(name.data()), name.size()};
+				auto const ext = extension_of(filename);
+				if (!accepts(extensions_, ext)) return;
+
+				if (with_stat_ && !has_stat) {
+					if (::fstatat(dirfd, dirent.d_name, &st, 0)) return;
+					has_stat = true;
+				}
+
+				auto const prefix_length = path_.size();
+				path_.append(filename);
+
+				walk_entry entry{.path = path_,
+				                 .extension = std::u8string_view{path_}.substr(
+				                     path_.size() - ext.size())};
+				if (with_stat_) {
+					entry.size = static_cast<std::uintmax_t>(st.st_size);
+					entry.mtime = file_time(st.st_mtim);
+				}
+				visitor_(entry);
+
+				path_.resize(prefix_length);
+			}
+
+			std::span<std::u8string_view const> extensions_;
+			bool with_stat_;
+			walk_visitor const& visitor_;
+			std::u8string path_{};
+			std::vector<char> buffer_ = std::vector<char>(64 * 1024);
+		};
+#endif
+	}  // namespace
+
+	bool walk(fs::path const& root,
+	          std::span<std::u8string_view const> extensions,
+	          bool with_stat,
+	          walk_visitor const& visitor) {
+#if defined(__linux__)
+		auto const fd =
+		    ::open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (fd < 0) return false;
+		walker{extensions, with_stat, visitor}.visit(fd);
+		return true;
+#else
+		std::error_code ec{};
+		fs::recursive_directory_iterator iterator{root, ec};
+		if (ec) return false;
+
+		std::u8string path{};
+		for (auto&& dir_entry : iterator) {
+			if (dir_entry.is_directory(ec)) continue;
+			auto const filename = dir_entry.path().filename().u8string();
+			auto const ext = extension_of(filename);
+			if (!accepts(extensions, ext)) continue;
+
+			// lexical only; fs::relative would canonicalize both paths
+			path = dir_entry.path().lexically_relative(root).generic_u8string();
+			walk_entry entry{.path = path,
+			                 .extension = std::u8string_view{path}.substr(
+			                     path.size() - ext.size())};
+			if (with_stat) {
+				entry.size = dir_entry.file_size(ec);
+				entry.mtime = dir_entry.last_write_time(ec);
+			}
+			visitor(entry);
+		}
+		return true;
+#endif
+	}
+}  // namespace io
@@ -0,0 +1,602 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+#include <atomic>
+#include <io/walk.hpp>
+#include <movies/db_info.hpp>
+#include <movies/diff.hpp>
+#include <movies/watch.hpp>
+#include <mutex>
+#include <set>
+#include "library.hpp"
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#include <system_error>
+#else
+#include <condition_variable>
+#endif
+
+using namespace std::literals;
+
+namespace movies {
+	namespace {
+		static constexpr auto JSON_EXT = u8".json"sv;
+		static constexpr auto ALIASES_JSON = u8"iso-alpha-2.json"sv;
+
+		bool is_video(fs_string_view ext) {
+			return ext == u8".mp4"sv || ext == u8".mkv"sv;
+		}
+
+		bool starts_with(fs_string_view id, fs_string_view prefix) {
+			return id.substr(0, prefix.size()) == prefix;
+		}
+
+		enum class root_dir { infos, videos, db };
+
+		struct touched_ids {
+			std::set<fs_string> infos{};
+			std::set<fs_string> videos{};
+			bool aliases{false};
+
+			bool empty() const noexcept {
+				return infos.empty() && videos.empty() && !aliases;
+			}
+
+			// Takes a path relative to the root it was found in.
+			void file(root_dir root, fs_string_view name) {
+				auto const ext =
+				    fs::path{name}.extension().generic_u8string();
+				auto const id = name.substr(0, name.size() - ext.size());
+				if (root == root_dir::infos && ext == JSON_EXT)
+					infos.insert(fs_string{id});
+				else if (root == root_dir::videos && is_video(ext))
+					videos.insert(fs_string{id});
+			}
+
+			void tree(root_dir root,
+			          fs::path const& dir,
+			          fs_string_view prefix) {
+				auto name = fs_string{prefix};
+				io::walk(dir, {}, false, [&](io::walk_entry const& entry) {
+					name.resize(prefix.size());
+					name.append(entry.path);
+					file(root, name);
+				});
+			}
+		};
+
+		// Who is who in the library: the nfo id and the video id, which
+		// make up a single loaded_movie.
+		struct layout_entry {
+			std::optional<fs_string> info{};
+			std::optional<fs_string> video{};
+
+			bool operator==(layout_entry const&) const noexcept = default;
+		};
+
+		class library_state {
+		public:
+			library_state(movies_dirs const& dirs, bool store_updates)
+			    : dirs_{dirs}, store_updates_{store_updates} {}
+
+			// The first, full scan. Called once the watches are in place,
+			// so a file changed while it runs is also seen as an event,
+			// and not lost between the scan and the watch.
+			void load(unsigned jobs) {
+				aka_.load(dirs_.infos / ".."sv);
+				jsons_ = known_movies(dirs_, store_updates_, jobs, nullptr);
+				for (auto& id : downloaded_movies(dirs_))
+					videos_.insert(std::move(id));
+				apply({});
+			}
+
+			movies_dirs const& dirs() const noexcept { return dirs_; }
+
+			library_delta apply(touched_ids touched) {
+				if (touched.aliases) {
+					aka_.load(dirs_.infos / ".."sv);
+					// the countries of every single nfo may change now
+					for (auto const& [id, _] : jsons_)
+						touched.infos.insert(id);
+				}
+
+				for (auto const& id : touched.infos)
+					reparse(id);
+
+				for (auto const& id : touched.videos) {
+					if (video_exists(id))
+						videos_.insert(id);
+					else
+						videos_.erase(id);
+				}
+
+				rematch(touched);
+				return publish(touched);
+			}
+
+			// Marks everything, which is known or present, for a new look.
+			void touch_all(touched_ids& touched) const {
+				touched.aliases = true;
+				for (auto const& [id, _] : jsons_)
+					touched.infos.insert(id);
+				for (auto const& id : videos_)
+					touched.videos.insert(id);
+				touched.tree(root_dir::infos, dirs_.infos, {});
+				touched.tree(root_dir::videos, dirs_.videos, {});
+			}
+
+			// Marks all the known ids in a directory, which came or went.
+			void touch_prefix(root_dir root,
+			                  fs_string_view prefix,
+			                  touched_ids& touched) const {
+				if (root == root_dir::infos) {
+					for (auto it = jsons_.lower_bound(fs_string{prefix});
+					     it != jsons_.end() && starts_with(it->first, prefix);
+					     ++it)
+						touched.infos.insert(it->first);
+				} else if (root == root_dir::videos) {
+					for (auto it = videos_.lower_bound(fs_string{prefix});
+					     it != videos_.end() && starts_with(*it, prefix); ++it)
+						touched.videos.insert(*it);
+				}
+			}
+
+			vector<loaded_movie> movies() const {
+				vector<loaded_movie> result{};
+				result.reserve(current_.size());
+				for (auto const& [_, movie] : current_)
+					result.push_back(movie);
+				return result;
+			}
+
+		private:
+			bool video_exists(fs_string const& id) const {
+				std::error_code ec{};
+				auto const& root = dirs_.videos;
+				return fs::is_regular_file(root / (id + u8".mp4"), ec) ||
+				       fs::is_regular_file(root / (id + u8".mkv"), ec);
+			}
+
+			void reparse(fs_string const& id) {
+				std::error_code ec{};
+				if (!fs::is_regular_file(dirs_.infos / (id + u8".json"), ec)) {
+					jsons_.erase(id);
+					return;
+				}
+
+				movie_info info{};
+				std::string dbg{};
+				auto const status =
+				    info.load(dirs_.infos, as_view(id), aka_, dbg);
+				if (status == json::conv_result::failed) {
+					jsons_.erase(id);
+					return;
+				}
+				if (status == json::conv_result::updated && store_updates_)
+					info.store(dirs_.infos, as_view(id));
+				jsons_[id] = std::move(info);
+			}
+
+			void rematch(touched_ids const& touched) {
+				// a match is dropped, if either side is gone, if the nfo
+				// (and with it, the titles) changed, or if any of the two
+				// ids found its exact match
+				std::erase_if(fuzzy_, [&](auto const& pair) {
+					auto const& [info, video] = pair;
+					return !jsons_.count(info) || !videos_.count(video) ||
+					       touched.infos.count(info) || videos_.count(info) ||
+					       jsons_.count(video);
+				});
+
+				std::set<fs_string> matched_videos{};
+				for (auto const& [_, video] : fuzzy_)
+					matched_videos.insert(video);
+
+				vector<fs_string> fresh_infos{};
+				vector<fs_string> old_infos{};
+				for (auto const& [id, _] : jsons_) {
+					if (videos_.count(id) || fuzzy_.count(id)) continue;
+					auto const fresh =
+					    touched.infos.count(id) || !orphan_infos_.count(id);
+					(fresh ? fresh_infos : old_infos).push_back(id);
+				}
+
+				vector<fs_string> unmatched_videos{};
+				for (auto const& id : videos_) {
+					if (jsons_.count(id) || matched_videos.count(id)) continue;
+					unmatched_videos.push_back(id);
+				}
+
+				// Two old orphans were already compared to each other (and
+				// did not match), so only the new ids go through the
+				// differ: new infos against every unmatched video, then old
+				// infos against the new videos, which are still unmatched.
+				if (!fresh_infos.empty() && !unmatched_videos.empty())
+					add_matches(
+					    differ{jsons_, fresh_infos, unmatched_videos}.calc());
+
+				vector<fs_string> fresh_videos{};
+				for (auto const& id : unmatched_videos) {
+					if (!orphan_videos_.count(id)) fresh_videos.push_back(id);
+				}
+				if (!old_infos.empty() && !fresh_videos.empty())
+					add_matches(differ{jsons_, old_infos, fresh_videos}.calc());
+
+				orphan_infos_.clear();
+				for (auto const& [id, _] : jsons_) {
+					if (!videos_.count(id) && !fuzzy_.count(id))
+						orphan_infos_.insert(id);
+				}
+
+				matched_videos.clear();
+				for (auto const& [_, video] : fuzzy_)
+					matched_videos.insert(video);
+				orphan_videos_.clear();
+				for (auto const& id : videos_) {
+					if (!jsons_.count(id) && !matched_videos.count(id))
+						orphan_videos_.insert(id);
+				}
+			}
+
+			void add_matches(vector<diff> const& matches) {
+				for (auto const& match : matches)
+					fuzzy_[match.info] = match.video;
+			}
+
+			library_delta publish(touched_ids const& touched) {
+				map<string_type, layout_entry> layout{};
+				for (auto const& [id, _] : jsons_) {
+					layout_entry entry{.info = id};
+					if (videos_.count(id))
+						entry.video = id;
+					else if (auto it = fuzzy_.find(id); it != fuzzy_.end())
+						entry.video = it->second;
+					layout.insert({id, std::move(entry)});
+				}
+				for (auto const& id : orphan_videos_)
+					layout.insert({id, {.video = id}});
+
+				library_delta delta{};
+				for (auto const& [id, entry] : layout) {
+					auto const prev = layout_.find(id);
+					auto const dirty =
+					    prev == layout_.end() || prev->second != entry ||
+					    (entry.info && touched.infos.count(*entry.info)) ||
+					    (entry.video && touched.videos.count(*entry.video));
+					if (!dirty) continue;
+
+					auto movie = make_movie(entry);
+					auto it = current_.find(id);
+					if (it == current_.end()) {
+						delta.added.push_back(movie);
+						current_.insert({id, std::move(movie)});
+					} else if (it->second != movie) {
+						delta.changed.push_back(movie);
+						it->second = std::move(movie);
+					}
+				}
+
+				for (auto it = current_.begin(); it != current_.end();) {
+					if (layout.count(it->first)) {
+						++it;
+						continue;
+					}
+					delta.removed.push_back(it->first);
+					it = current_.erase(it);
+				}
+
+				layout_ = std::move(layout);
+				return delta;
+			}
+
+			loaded_movie make_movie(layout_entry const& entry) const {
+				std::optional<file_ref> video_file{};
+				std::optional<file_ref> info_file{};
+				if (entry.video) video_file = video_ref(dirs_, *entry.video);
+				if (entry.info) info_file = info_ref(dirs_, *entry.info);
+				if (!entry.info) return make_empty(video_file, info_file);
+				return {jsons_.at(*entry.info), video_file, info_file};
+			}
+
+			movies_dirs dirs_;
+			bool store_updates_;
+			alpha_2_aliases aka_{};
+
+			map<fs_string, movie_info> jsons_{};
+			std::set<fs_string> videos_{};
+			// info id -> video id, for the pairs found by the differ
+			map<fs_string, fs_string> fuzzy_{};
+			std::set<fs_string> orphan_infos_{};
+			std::set<fs_string> orphan_videos_{};
+
+			map<string_type, layout_entry> layout_{};
+			map<string_type, loaded_movie> current_{};
+		};
+
+		// How long the directories need to stay quiet, before the events
+		// gathered so far are applied; copying a movie into the library
+		// should not end up as a hundred deltas.
+		static constexpr auto SETTLE_TIME = 100ms;
+		static constexpr auto MAX_SETTLE_ROUNDS = 20;
+	}  // namespace
+
+#if defined(__linux__)
+	struct library_watch::impl {
+		struct watched_dir {
+			root_dir root;
+			// path of the directory relative to its root, with the
+			// trailing slash, if not empty
+			fs_string prefix;
+		};
+
+		library_state state;
+		std::atomic<bool> stopped{false};
+		int inotify{-1};
+		int wakeup{-1};
+		std::map<int, watched_dir> watches{};
+		// one next() at a time; movies() only waits for the apply()
+		std::mutex next_mtx{};
+		std::mutex state_mtx{};
+
+		static constexpr std::uint32_t DIR_MASK =
+		    IN_CLOSE_WRITE | IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+		    IN_MOVED_TO | IN_ONLYDIR;
+		static constexpr std::uint32_t DB_MASK =
+		    IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+		    IN_ONLYDIR;
+
+		impl(movies_config const& cfg, bool store_updates)
+		    : state{cfg.dirs, store_updates} {
+			inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			if (inotify < 0 || wakeup < 0) {
+				auto const error = errno;
+				close_all();
+				throw std::system_error(error, std::generic_category(),
+				                        "library_watch");
+			}
+
+			auto const& dirs = state.dirs();
+			add_watch(dirs.infos / ".."sv, root_dir::db, {}, DB_MASK);
+			// the files found here are all read by the load below
+			add_tree(dirs.infos, root_dir::infos, {}, nullptr);
+			add_tree(dirs.videos, root_dir::videos, {}, nullptr);
+
+			try {
+				state.load(cfg.jobs);
+			} catch (...) {
+				close_all();
+				throw;
+			}
+		}
+
+		~impl() { close_all(); }
+
+		void close_all() {
+			if (inotify >= 0) ::close(inotify);
+			if (wakeup >= 0) ::close(wakeup);
+			inotify = wakeup = -1;
+		}
+
+		void add_watch(fs::path const& dir,
+		               root_dir root,
+		               fs_string const& prefix,
+		               std::uint32_t mask) {
+			auto const wd = inotify_add_watch(inotify, dir.c_str(), mask);
+			// a directory gone before we got to it will show up as
+			// IN_DELETE in its parent anyway
+			if (wd < 0) return;
+			watches[wd] = {root, prefix};
+		}
+
+		// Watches every directory in the tree; the files, which are already
+		// there by the time the watch is in place, are marked as touched.
+		void add_tree(fs::path const& dir,
+		              root_dir root,
+		              fs_string const& prefix,
+		              touched_ids* touched) {
+			add_watch(dir, root, prefix, DIR_MASK);
+
+			std::error_code ec{};
+			fs::recursive_directory_iterator iterator{dir, ec};
+			if (ec) return;
+			for (auto&& entry : iterator) {
+				auto name = prefix;
+				name.append(
+				    entry.path().lexically_relative(dir).generic_u8string());
+				if (fs::is_directory(entry.status())) {
+					add_watch(entry.path(), root, name + u8'/', DIR_MASK);
+					continue;
+				}
+				if (touched) touched->file(root, name);
+			}
+		}
+
+		void handle(inotify_event const& event, touched_ids& touched) {
+			if (event.mask & IN_Q_OVERFLOW) {
+				state.touch_all(touched);
+				return;
+			}
+
+			auto it = watches.find(event.wd);
+			if (it == watches.end()) return;
+			if (event.mask & IN_IGNORED) {
+				watches.erase(it);
+				return;
+			}
+			if (!event.len) return;
+
+			auto const dir = it->second;
+			auto name = dir.prefix;
+			name.append(reinterpret_cast<char8_t const*>(event.name));
+
+			if (dir.root == root_dir::db) {
+				if (name == ALIASES_JSON) touched.aliases = true;
+				return;
+			}
+
+			if (!(event.mask & IN_ISDIR)) {
+				touched.file(dir.root, name);
+				return;
+			}
+
+			// a whole subtree came or went
+			name.push_back(u8'/');
+			state.touch_prefix(dir.root, name, touched);
+			if (event.mask & (IN_CREATE | IN_MOVED_TO)) {
+				auto const& root_path = dir.root == root_dir::infos
+				                            ? state.dirs().infos
+				                            : state.dirs().videos;
+				add_tree(root_path / name, dir.root, name, &touched);
+			}
+		}
+
+		// Returns false, if nothing happened within the timeout, or if the
+		// watch was stopped.
+		bool wait(int timeout_ms) {
+			pollfd fds[] = {{.fd = inotify, .events = POLLIN, .revents = 0},
+			                {.fd = wakeup, .events = POLLIN, .revents = 0}};
+			while (true) {
+				auto const ready = ::poll(fds, std::size(fds), timeout_ms);
+				if (ready < 0 && errno == EINTR) continue;
+				if (ready < 0)
+					throw std::system_error(errno, std::generic_category(),
+					                        "library_watch");
+				if (stopped) return false;
+				return ready > 0 && (fds[0].revents & POLLIN);
+			}
+		}
+
+		void read_events(touched_ids& touched) {
+			alignas(inotify_event) char buffer[64 * 1024];
+			while (true) {
+				auto const length = ::read(inotify, buffer, sizeof(buffer));
+				if (length <= 0) break;
+				for (auto ptr = buffer; ptr < buffer + length;) {
+					auto const& event =
+					    *reinterpret_cast<inotify_event const*>(ptr);
+					handle(event, touched);
+					ptr += sizeof(inotify_event) + event.len;
+				}
+			}
+		}
+
+		bool gather(std::chrono::milliseconds timeout, touched_ids& touched) {
+			if (!wait(static_cast<int>(timeout.count()))) return false;
+			read_events(touched);
+			for (int round = 0; round < MAX_SETTLE_ROUNDS; ++round) {
+				if (!wait(static_cast<int>(SETTLE_TIME.count()))) break;
+				read_events(touched);
+			}
+			return !stopped;
+		}
+
+		void stop() {
+			stopped = true;
+			std::uint64_t const one = 1;
+			[[maybe_unused]] auto const ignore =
+			    ::write(wakeup, &one, sizeof(one));
+		}
+	};
+#else
+	struct library_watch::impl {
+		library_state state;
+		std::atomic<bool> stopped{false};
+		std::mutex mtx{};
+		std::condition_variable cv{};
+		// one next() at a time; movies() only waits for the apply()
+		std::mutex next_mtx{};
+		std::mutex state_mtx{};
+
+		// Without a way to be told about the changes, the library is
+		// rescanned as often as this.
+		static constexpr auto POLL_INTERVAL = 5s;
+
+		impl(movies_config const& cfg, bool store_updates)
+		    : state{cfg.dirs, store_updates} {
+			state.load(cfg.jobs);
+		}
+
+		bool gather(std::chrono::milliseconds timeout, touched_ids& touched) {
+			auto const interval =
+			    timeout.count() < 0
+			        ? std::chrono::milliseconds{POLL_INTERVAL}
+			        : (std::min)(timeout, std::chrono::milliseconds{
+			                                  POLL_INTERVAL});
+			{
+				std::unique_lock lock{mtx};
+				cv.wait_for(lock, interval, [this] { return stopped.load(); });
+			}
+			if (stopped) return false;
+			state.touch_all(touched);
+			return true;
+		}
+
+		void stop() {
+			{
+				std::lock_guard lock{mtx};
+				stopped = true;
+			}
+			cv.notify_all();
+		}
+	};
+#endif
+
+	library_watch::library_watch(movies_config const& cfg, bool store_updates)
+	    : impl_{std::make_unique<impl>(cfg, store_updates)} {}
+
+	library_watch::~library_watch() = default;
+	library_watch::library_watch(library_watch&&) noexcept = default;
+	library_watch& library_watch::operator=(library_watch&&) noexcept =
+	    default;
+
+	vector<loaded_movie> library_watch::movies() const {
+		std::lock_guard lock{impl_->state_mtx};
+		return impl_->state.movies();
+	}
+
+	std::optional<library_delta> library_watch::next(
+	    std::chrono::milliseconds timeout) {
+		using clock = std::chrono::steady_clock;
+		auto const forever = timeout.count() < 0;
+		auto const deadline = clock::now() + (forever ? 0ms : timeout);
+
+		// the gathering is only ever read by this thread; the state is
+		// also read by movies()
+		std::lock_guard serial{impl_->next_mtx};
+		while (!impl_->stopped) {
+			auto left = forever ? timeout : 0ms;
+			if (!forever) {
+				left = std::chrono::duration_cast<std::chrono::milliseconds>(
+				    deadline - clock::now());
+				if (left.count() < 0) left = 0ms;
+			}
+
+			touched_ids touched{};
+			auto const gathered = impl_->gather(left, touched);
+			if (gathered && !touched.empty()) {
+				library_delta delta{};
+				{
+					std::lock_guard lock{impl_->state_mtx};
+					delta = impl_->state.apply(std::move(touched));
+				}
+				if (!delta.empty()) return delta;
+			}
+			if (!forever && clock::now() >= deadline) break;
+		}
+		return std::nullopt;
+	}
+
+	void library_watch::stop() { impl_->stop(); }
+
+	bool library_watch::stopped() const noexcept { return impl_->stopped; }
+
+	library_watch movies_config::watch(bool store_updates) const {
+		return library_watch{*this, store_updates};
+	}
+}  // namespace movies
@@ -0,0 +1,285 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+// The differ prunes most of the pairs before any ratio() is computed,
+// splits the videos between threads, keeps the scores of the earlier runs
+// in a fuzzy_cache and matches the videos again, once the few calls it
+// kept for them were taken. None of it may change what is matched: every
+// result is compared here with the plain differ, which scores every info
+// against every video and sorts all the close calls.
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <movies/diff.hpp>
+#include <movies/fuzzy_cache.hpp>
+#include <movies/movie_info.hpp>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include "difflib.hpp"
+
+namespace movies {
+	namespace {
+		int failures = 0;
+		int checks = 0;
+
+		struct library {
+			map<std::u8string, movie_info> jsons{};
+			vector<std::u8string> infos{};
+			vector<std::u8string> videos{};
+		};
+
+		double similar(std::u8string_view a, std::u8string_view b) {
+			return difflib::MakeSequenceMatcher(a, b).ratio();
+		}
+
+		std::u8string spaced(std::u8string text) {
+			for (auto& c : text) {
+				if (c == u8'-' || c == u8'_') c = u8' ';
+			}
+			return text;
+		}
+
+		// The titles made up below are all ASCII.
+		std::u8string lowercased(std::u8string text) {
+			for (auto& c : text) {
+				if (c >= u8'A' && c <= u8'Z') c = c - u8'A' + u8'a';
+			}
+			return text;
+		}
+
+		vector<diff> reference_calc(library& lib) {
+			// This trully is a magic number
+			constexpr auto min_ratio = 0.8;  // NOLINT
+
+			vector<diff> close_calls{};
+			for (auto const& info : lib.infos) {
+				auto const& mv = lib.jsons.at(info);
+				auto const info_key = spaced(info);
+				vector<std::u8string> titles{};
+				for (auto const& [_, title] : mv.title.items)
+					titles.push_back(lowercased(title.text));
+
+				for (auto const& video : lib.videos) {
+					auto const video_key = spaced(video);
+					auto ratio = similar(info_key, video_key);
+					for (auto const& title : titles)
+						ratio = (std::max)(ratio, similar(title, video_key));
+					if (ratio < min_ratio) continue;
+					close_calls.push_back({ratio, video, info});
+				}
+			}
+
+			std::sort(close_calls.begin(), close_calls.end(),
+			          std::greater<diff>{});
+			std::unordered_set<std::u8string> used_infos;
+			std::unordered_set<std::u8string> used_videos;
+
+			vector<diff> result{};
+			for (auto& call : close_calls) {
+				if (used_infos.count(call.info) ||
+				    used_videos.count(call.video))
+					continue;
+				used_infos.insert(call.info);
+				used_videos.insert(call.video);
+				result.push_back(std::move(call));
+			}
+
+			std::erase_if(lib.infos, [&](std::u8string const& id) {
+				return used_infos.count(id) != 0;
+			});
+			std::erase_if(lib.videos, [&](std::u8string const& id) {
+				return used_videos.count(id) != 0;
+			});
+			return result;
+		}
+
+		std::u8string random_words(std::mt19937& rng) {
+			static constexpr std::u8string_view words[] = {
+			    u8"the",   u8"star",  u8"war",  u8"return", u8"of",
+			    u8"king",  u8"lord",  u8"ring", u8"matrix", u8"love",
+			    u8"night", u8"day",   u8"man",  u8"woman",  u8"blue",
+			    u8"red",   u8"river", u8"city", u8"dark",   u8"light",
+			    u8"a",     u8"house", u8"moon", u8"sun",    u8"x",
+			    u8"ii",    u8"iii",   u8"2019", u8"2020",
+			};
+			std::uniform_int_distribution<std::size_t> count{1, 4};
+			std::uniform_int_distribution<std::size_t> pick{
+			    0, std::size(words) - 1};
+			std::u8string result{};
+			for (auto index = count(rng); index > 0; --index) {
+				if (!result.empty()) result.push_back(u8'-');
+				result.append(words[pick(rng)]);
+			}
+			return result;
+		}
+
+		// Hundreds of ids this close to each other give every video more
+		// close calls than the differ keeps, so it has to go back to the
+		// infos for many of them.
+		std::u8string dense_words(std::mt19937& rng) {
+			std::uniform_int_distribution<int> letter{0, 5};
+			std::u8string result{u8"the-lord-of-rings-"};
+			result.push_back(static_cast<char8_t>(u8'a' + letter(rng)));
+			result.push_back(static_cast<char8_t>(u8'a' + letter(rng)));
+			return result;
+		}
+
+		std::u8string mutate(std::mt19937& rng, std::u8string text) {
+			std::uniform_int_distribution<int> edits{0, 4};
+			for (auto count = edits(rng); count > 0 && !text.empty();
+			     --count) {
+				std::uniform_int_distribution<std::size_t> at{
+				    0, text.size() - 1};
+				auto const pos = at(rng);
+				switch (edits(rng) % 3) {
+					case 0:
+						text.erase(pos, 1);
+						break;
+					case 1:
+						text.insert(pos, 1, u8'x');
+						break;
+					default:
+						text[pos] = u8'_';
+				}
+			}
+			return text;
+		}
+
+		void sort_unique(vector<std::u8string>& ids) {
+			std::sort(ids.begin(), ids.end());
+			ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+		}
+
+		library make_library(std::mt19937& rng, int count, bool dense) {
+			library result{};
+			for (int index = 0; index < count; ++index) {
+				auto const words = dense ? dense_words(rng) : random_words(rng);
+				auto id = words;
+				id.push_back(u8'-');
+				id.push_back(static_cast<char8_t>(u8'a' + index % 26));
+				id.push_back(static_cast<char8_t>(u8'a' + (index / 26) % 26));
+
+				movie_info mv{};
+				title_info title{};
+				title.text = spaced(id);
+				if (rng() % 3 == 0) title.text[0] = u8'T';
+				mv.title.items[""] = title;
+				if (rng() % 2) {
+					title.text = spaced(random_words(rng));
+					mv.title.items["pl"] = title;
+				}
+				result.jsons[id] = mv;
+				result.infos.push_back(id);
+
+				result.videos.push_back(rng() % 2 ? mutate(rng, id)
+				                                  : random_words(rng));
+				// and twice as many videos as infos, so the best infos of
+				// many videos are taken by the others
+				if (dense) result.videos.push_back(mutate(rng, id));
+				// an info and a video, which only match to an empty key
+				if (rng() % 10 == 0) {
+					result.jsons[u8"q"] = mv;
+					result.infos.push_back(u8"q");
+					result.videos.push_back(u8"");
+				}
+			}
+			sort_unique(result.infos);
+			sort_unique(result.videos);
+			return result;
+		}
+
+		void check(char const* what,
+		           int round,
+		           library const& expected,
+		           vector<diff> const& expected_diffs,
+		           library const& actual,
+		           vector<diff> const& actual_diffs) {
+			++checks;
+			if (expected_diffs == actual_diffs &&
+			    expected.infos == actual.infos &&
+			    expected.videos == actual.videos)
+				return;
+			++failures;
+			std::fprintf(stderr,
+			             "round %d, %s: %zu matches, %zu expected; %zu/%zu "
+			             "left, %zu/%zu expected\n",
+			             round, what, actual_diffs.size(),
+			             expected_diffs.size(), actual.infos.size(),
+			             actual.videos.size(), expected.infos.size(),
+			             expected.videos.size());
+
+			auto const [mismatch, _] = std::mismatch(
+			    actual_diffs.begin(), actual_diffs.end(),
+			    expected_diffs.begin(), expected_diffs.end());
+			if (mismatch == actual_diffs.end()) return;
+			std::fprintf(stderr, "  first different: %s -> %s (%f)\n",
+			             reinterpret_cast<char const*>(mismatch->video.c_str()),
+			             reinterpret_cast<char const*>(mismatch->info.c_str()),
+			             mismatch->ratio);
+		}
+
+		void check_round(int round, int count, bool dense) {
+			std::mt19937 rng{static_cast<std::mt19937::result_type>(round)};
+			auto const lib = make_library(rng, count, dense);
+
+			auto expected = lib;
+			auto const expected_diffs = reference_calc(expected);
+
+			for (unsigned jobs = 1; jobs <= 3; ++jobs) {
+				auto actual = lib;
+				auto const diffs =
+				    differ{lib.jsons, actual.infos, actual.videos, nullptr,
+				           jobs}
+				        .calc();
+				check("no cache", round, expected, expected_diffs, actual,
+				      diffs);
+
+				// the first pass fills the cache, the second takes the
+				// scores from it; with a small cache, only some of them
+				for (auto const capacity :
+				     {fuzzy_cache::default_capacity, std::size_t{64}}) {
+					fuzzy_cache cache{};
+					cache.capacity = capacity;
+					for (int pass = 0; pass < 2; ++pass) {
+						auto cached = lib;
+						differ_counters counters{};
+						auto const cached_diffs =
+						    differ{lib.jsons,
+						           cached.infos,
+						           cached.videos,
+						           &counters,
+						           jobs,
+						           similarity_metric::ratio,
+						           &cache}
+						        .calc();
+						check(pass ? "warm cache" : "cold cache", round,
+						      expected, expected_diffs, cached,
+						      cached_diffs);
+						if (pass && capacity == fuzzy_cache::default_capacity &&
+						    counters.ratio_evaluations) {
+							++failures;
+							std::fprintf(stderr,
+							             "round %d: %zu ratios with a warm "
+							             "cache\n",
+							             round, counters.ratio_evaluations);
+						}
+					}
+				}
+			}
+		}
+	}  // namespace
+}  // namespace movies
+
+int main() {
+	for (int round = 0; round < 4; ++round)
+		movies::check_round(round, 150, false);
+	for (int round = 4; round < 6; ++round)
+		movies::check_round(round, 120, true);
+
+	std::printf("%d differs compared, %d differences\n", movies::checks,
+	            movies::failures);
+	return movies::failures ? 1 : 0;
+}
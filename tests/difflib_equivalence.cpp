@@ -0,0 +1,261 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+// The SequenceMatcher over bytes keeps b in a 256-bucket table, while any
+// other element type goes through the hashed index. Both have to see the
+// same matches: the same bytes, widened to char32_t, are compared with
+// each of them and every result is checked to be identical. Both are
+// also checked against the results recorded before either index was
+// written, in difflib_golden.inc.
+
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "difflib.hpp"
+
+namespace {
+	using bytes_matcher = difflib::SequenceMatcher<std::u8string_view>;
+	using generic_matcher = difflib::SequenceMatcher<std::u32string>;
+
+	static_assert(!std::is_same_v<bytes_matcher::junk_function_type,
+	                              generic_matcher::junk_function_type>,
+	              "both indexes of b have to be covered");
+
+	int failures = 0;
+	int checks = 0;
+
+	std::u32string widen(std::u8string_view text) {
+		std::u32string result{};
+		result.reserve(text.size());
+		for (auto const c : text)
+			result.push_back(static_cast<char32_t>(c));
+		return result;
+	}
+
+	bool is_space(char8_t const& c) { return c == u8' '; }
+	bool is_space32(char32_t const& c) { return c == U' '; }
+
+	struct junk_mode {
+		char const* name;
+		bytes_matcher::junk_function_type bytes;
+		generic_matcher::junk_function_type generic;
+		bool auto_junk;
+	};
+
+	junk_mode const modes[] = {
+	    {"plain", nullptr, nullptr, false},
+	    {"autojunk", nullptr, nullptr, true},
+	    {"junk", is_space, is_space32, false},
+	    {"junk+autojunk", is_space, is_space32, true},
+	};
+
+	void report(char const* what,
+	            junk_mode const& mode,
+	            std::u8string_view a,
+	            std::u8string_view b) {
+		++failures;
+		if (failures > 10) return;
+		std::fprintf(stderr, "%s differs (%s)\n  a: \"%.*s\"\n  b: \"%.*s\"\n",
+		             what, mode.name, static_cast<int>(a.size()),
+		             reinterpret_cast<char const*>(a.data()),
+		             static_cast<int>(b.size()),
+		             reinterpret_cast<char const*>(b.data()));
+	}
+
+	// Everything the matchers report for their current pair. The order of
+	// the calls is the one the differ uses: the cheap bounds first.
+	void compare(bytes_matcher& bytes,
+	             generic_matcher& generic,
+	             junk_mode const& mode,
+	             std::u8string_view a,
+	             std::u8string_view b) {
+		++checks;
+		if (bytes.real_quick_ratio() != generic.real_quick_ratio())
+			report("real_quick_ratio()", mode, a, b);
+		if (bytes.quick_ratio() != generic.quick_ratio())
+			report("quick_ratio()", mode, a, b);
+		if (bytes.ratio() != generic.ratio()) report("ratio()", mode, a, b);
+		if (bytes.get_matching_blocks() != generic.get_matching_blocks())
+			report("get_matching_blocks()", mode, a, b);
+		if (bytes.get_opcodes() != generic.get_opcodes())
+			report("get_opcodes()", mode, a, b);
+	}
+
+	struct golden_pair {
+		int mode;
+		std::u8string_view a;
+		std::u8string_view b;
+		double ratio;
+		double quick_ratio;
+		double real_quick_ratio;
+		// "<first letter of the tag><i1>:<i2>:<j1>:<j2>", space separated
+		char const* opcodes;
+	};
+
+	golden_pair const golden[] = {
+#include "difflib_golden.inc"
+	};
+
+	template <typename Matcher>
+	std::string opcodes_of(Matcher& matcher) {
+		std::ostringstream out{};
+		auto first = true;
+		for (auto const& [tag, i1, i2, j1, j2] : matcher.get_opcodes()) {
+			if (!first) out << ' ';
+			first = false;
+			out << tag.front() << i1 << ':' << i2 << ':' << j1 << ':' << j2;
+		}
+		return out.str();
+	}
+
+	// The matching blocks are the "equal" opcodes and the sentinel.
+	template <typename Matcher>
+	difflib::match_list_t blocks_of(Matcher& matcher) {
+		difflib::match_list_t result{};
+		for (auto const& [tag, i1, i2, j1, j2] : matcher.get_opcodes()) {
+			if (tag == "equal") result.emplace_back(i1, j1, i2 - i1);
+		}
+		return result;
+	}
+
+	template <typename Matcher>
+	void check_golden(Matcher& matcher,
+	                  golden_pair const& pair,
+	                  junk_mode const& mode) {
+		++checks;
+		if (matcher.real_quick_ratio() != pair.real_quick_ratio)
+			report("golden real_quick_ratio()", mode, pair.a, pair.b);
+		if (matcher.quick_ratio() != pair.quick_ratio)
+			report("golden quick_ratio()", mode, pair.a, pair.b);
+		if (matcher.ratio() != pair.ratio)
+			report("golden ratio()", mode, pair.a, pair.b);
+		if (opcodes_of(matcher) != pair.opcodes)
+			report("golden get_opcodes()", mode, pair.a, pair.b);
+
+		auto blocks = blocks_of(matcher);
+		blocks.emplace_back(pair.a.size(), pair.b.size(), 0);
+		if (matcher.get_matching_blocks() != blocks)
+			report("golden get_matching_blocks()", mode, pair.a, pair.b);
+	}
+
+	// Fresh matchers, and ones reused after a different a, must all give
+	// what the matcher gave before the indexes were split.
+	void check_goldens() {
+		for (auto const& pair : golden) {
+			auto const& mode = modes[pair.mode];
+			auto const a32 = widen(pair.a);
+			auto const b32 = widen(pair.b);
+
+			bytes_matcher bytes{pair.a, pair.b, mode.bytes, mode.auto_junk};
+			generic_matcher generic{a32, b32, mode.generic, mode.auto_junk};
+			check_golden(bytes, pair, mode);
+			check_golden(generic, pair, mode);
+
+			bytes.set_seq1(pair.b);
+			generic.set_seq1(b32);
+			bytes.ratio();
+			generic.ratio();
+			bytes.set_seq1(pair.a);
+			generic.set_seq1(a32);
+			check_golden(bytes, pair, mode);
+			check_golden(generic, pair, mode);
+		}
+	}
+
+	std::u8string random_text(std::mt19937& rng,
+	                          std::size_t max_length,
+	                          std::u8string_view alphabet) {
+		std::uniform_int_distribution<std::size_t> length{0, max_length};
+		std::uniform_int_distribution<std::size_t> pick{0,
+		                                                alphabet.size() - 1};
+		std::u8string result(length(rng), u8' ');
+		for (auto& c : result)
+			c = alphabet[pick(rng)];
+		return result;
+	}
+
+	// b with some of its bytes replaced, dropped or doubled, so there are
+	// long matches to find, and not only the single-byte ones.
+	std::u8string mutate(std::mt19937& rng,
+	                     std::u8string_view b,
+	                     std::u8string_view alphabet) {
+		std::uniform_int_distribution<int> edit{0, 9};
+		std::uniform_int_distribution<std::size_t> pick{0,
+		                                                alphabet.size() - 1};
+		std::u8string result{};
+		for (auto const c : b) {
+			switch (edit(rng)) {
+				case 0:
+					result.push_back(alphabet[pick(rng)]);
+					break;
+				case 1:
+					break;
+				case 2:
+					result.push_back(c);
+					result.push_back(c);
+					break;
+				default:
+					result.push_back(c);
+			}
+		}
+		return result;
+	}
+
+	void check_pairs(std::mt19937& rng,
+	                 int rounds,
+	                 std::size_t max_length,
+	                 std::u8string_view alphabet) {
+		for (auto const& mode : modes) {
+			for (int round = 0; round < rounds; ++round) {
+				auto const b = random_text(rng, max_length, alphabet);
+				auto const b32 = widen(b);
+
+				// one matcher per b, as in the differ; set_seq1() has to
+				// leave nothing behind from the previous a
+				bytes_matcher bytes{{}, b, mode.bytes, mode.auto_junk};
+				generic_matcher generic{{}, b32, mode.generic, mode.auto_junk};
+
+				for (int index = 0; index < 8; ++index) {
+					auto const a = index % 2
+					                   ? mutate(rng, b, alphabet)
+					                   : random_text(rng, max_length, alphabet);
+					bytes.set_seq1(a);
+					generic.set_seq1(widen(a));
+					compare(bytes, generic, mode, a, b);
+
+					// and a fresh pair of matchers must agree with both
+					bytes_matcher fresh_bytes{a, b, mode.bytes, mode.auto_junk};
+					generic_matcher fresh_generic{widen(a), b32, mode.generic,
+					                              mode.auto_junk};
+					if (fresh_bytes.get_matching_blocks() !=
+					    bytes.get_matching_blocks())
+						report("set_seq1()", mode, a, b);
+					compare(fresh_bytes, fresh_generic, mode, a, b);
+				}
+			}
+		}
+	}
+}  // namespace
+
+int main() {
+	check_goldens();
+
+	std::mt19937 rng{20231017};
+
+	// short titles, with the matches mostly between single letters
+	check_pairs(rng, 200, 40, u8"abcdefgh ");
+	// above auto_junk_minsize, where the popular bytes are dropped; with
+	// few letters all of them are popular, with many only some are
+	check_pairs(rng, 40, 400, u8"abcd efghij");
+	check_pairs(rng, 40, 400,
+	            u8"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"
+	            u8"0123456789 .,-:;!?()[]{}<>@#$%^&*_+=/|~");
+	// bytes above 0x7F, which a signed char would see as negative
+	check_pairs(rng, 200, 60, u8"a\xc3\xa9\xc5\x82 b");
+
+	std::printf("%d pairs compared, %d differences\n", checks, failures);
+	return failures ? 1 : 0;
+}
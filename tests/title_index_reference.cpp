@@ -0,0 +1,221 @@
+// Copyright (c) 2023 midnightBITS
+// This code is licensed under MIT license (see LICENSE for details)
+
+// The title_index only scores the ids the posting index gives it, skips
+// the removed ones until they are the majority and then builds the
+// postings anew. None of it may change the answer: every search is
+// compared here with the ratio of the query to every id and title of the
+// library, taken one by one, while ids are inserted, replaced and removed
+// well past the point of the rebuild.
+
+#include <algorithm>
+#include <cstdio>
+#include <movies/movie_info.hpp>
+#include <movies/title_index.hpp>
+#include <random>
+#include <string>
+#include <string_view>
+#include "difflib.hpp"
+
+namespace movies {
+	namespace {
+		int failures = 0;
+		int checks = 0;
+
+		std::u8string spaced(std::u8string text) {
+			for (auto& c : text) {
+				if (c == u8'-' || c == u8'_') c = u8' ';
+			}
+			return text;
+		}
+
+		// The titles made up below are all ASCII.
+		std::u8string lowercased(std::u8string text) {
+			for (auto& c : text) {
+				if (c >= u8'A' && c <= u8'Z') c = c - u8'A' + u8'a';
+			}
+			return text;
+		}
+
+		double similar(std::u8string_view a, std::u8string_view b) {
+			return difflib::MakeSequenceMatcher(a, b).ratio();
+		}
+
+		bool ranks_before(title_match const& lhs, title_match const& rhs) {
+			if (lhs.score != rhs.score) return lhs.score > rhs.score;
+			return lhs.id < rhs.id;
+		}
+
+		vector<title_match> reference_search(
+		    map<std::u8string, movie_info> const& library,
+		    std::u8string_view query,
+		    std::size_t k,
+		    double min_score) {
+			auto const key = spaced(std::u8string{query});
+
+			vector<title_match> result{};
+			for (auto const& [id, info] : library) {
+				auto score = similar(spaced(id), key);
+				for (auto const& [_, title] : info.title.items) {
+					auto const text = lowercased(title.text);
+					score = (std::max)(score, similar(text, key));
+				}
+				if (score >= min_score) result.push_back({id, score});
+			}
+
+			std::sort(result.begin(), result.end(), ranks_before);
+			if (result.size() > k) result.resize(k);
+			return result;
+		}
+
+		std::u8string random_words(std::mt19937& rng) {
+			static constexpr std::u8string_view words[] = {
+			    u8"the",   u8"star",  u8"war",  u8"return", u8"of",
+			    u8"king",  u8"lord",  u8"ring", u8"matrix", u8"love",
+			    u8"night", u8"day",   u8"man",  u8"woman",  u8"blue",
+			    u8"red",   u8"river", u8"city", u8"dark",   u8"light",
+			    u8"a",     u8"house", u8"moon", u8"sun",    u8"x",
+			    u8"ii",    u8"iii",   u8"2019", u8"2020",
+			};
+			std::uniform_int_distribution<std::size_t> count{1, 4};
+			std::uniform_int_distribution<std::size_t> pick{
+			    0, std::size(words) - 1};
+			std::u8string result{};
+			for (auto index = count(rng); index > 0; --index) {
+				if (!result.empty()) result.push_back(u8'-');
+				result.append(words[pick(rng)]);
+			}
+			return result;
+		}
+
+		movie_info random_info(std::mt19937& rng) {
+			movie_info result{};
+			title_info title{};
+			title.text = spaced(random_words(rng));
+			title.text[0] = u8'T';
+			result.title.items["en"] = title;
+			if (rng() % 2) {
+				title.text = spaced(random_words(rng));
+				result.title.items["pl"] = title;
+			}
+			return result;
+		}
+
+		class tester {
+		public:
+			explicit tester(std::uint32_t seed) : rng_{seed} {}
+
+			void insert_new() {
+				auto id = random_words(rng_);
+				id.push_back(u8'-');
+				id.append(std::u8string(1, static_cast<char8_t>(
+				                               u8'a' + next_id_ % 26)));
+				id.append(std::u8string(1, static_cast<char8_t>(
+				                               u8'a' + next_id_ / 26 % 26)));
+				++next_id_;
+				auto const info = random_info(rng_);
+				library_[id] = info;
+				index_.insert(id, info);
+			}
+
+			// a new set of titles for a known id
+			void replace() {
+				if (library_.empty()) return;
+				auto it = pick();
+				it->second = random_info(rng_);
+				index_.insert(it->first, it->second);
+			}
+
+			void remove() {
+				if (library_.empty()) return;
+				auto it = pick();
+				if (!index_.remove(it->first)) {
+					++failures;
+					std::fprintf(stderr, "%s was not in the index\n",
+					             reinterpret_cast<char const*>(
+					                 it->first.c_str()));
+				}
+				library_.erase(it);
+			}
+
+			void search() {
+				static constexpr double min_scores[] = {0.8, 0.6, 0.0, 0.9,
+				                                        0.7};
+				++checks;
+				// half of the queries are near one of the ids
+				auto query = random_words(rng_);
+				if (!library_.empty() && rng_() % 2) {
+					query = pick()->first;
+					if (query.size() > 2) query[rng_() % query.size()] = u8'_';
+				}
+				auto const min_score = min_scores[checks % 5];
+				auto const k = static_cast<std::size_t>(1 + checks % 7);
+
+				auto const actual = index_.search(query, k, min_score);
+				auto const expected =
+				    reference_search(library_, query, k, min_score);
+				if (actual == expected && index_.size() == library_.size())
+					return;
+
+				++failures;
+				if (failures > 10) return;
+				std::fprintf(stderr,
+				             "\"%s\", k=%zu, min_score=%g: %zu found, %zu "
+				             "expected; %zu ids, %zu expected\n",
+				             reinterpret_cast<char const*>(query.c_str()), k,
+				             min_score, actual.size(), expected.size(),
+				             index_.size(), library_.size());
+			}
+
+			std::size_t size() const noexcept { return library_.size(); }
+
+		private:
+			map<std::u8string, movie_info>::iterator pick() {
+				auto it = library_.begin();
+				std::advance(it, rng_() % library_.size());
+				return it;
+			}
+
+			std::mt19937 rng_;
+			unsigned next_id_{};
+			map<std::u8string, movie_info> library_{};
+			title_index index_{};
+		};
+	}  // namespace
+}  // namespace movies
+
+int main() {
+	movies::tester test{20231017};
+
+	// grows, with the postings of the replaced titles piling up
+	for (int round = 0; round < 300; ++round) {
+		test.insert_new();
+		if (round % 3 == 0) test.replace();
+		if (round % 5 == 0) test.search();
+	}
+	// shrinks to a tenth, so the removed strings become the majority
+	// more than once
+	while (test.size() > 30) {
+		test.remove();
+		if (test.size() % 4 == 0) test.search();
+	}
+	// and everything at once
+	for (int round = 0; round < 600; ++round) {
+		switch (round % 4) {
+			case 0:
+			case 1:
+				test.insert_new();
+				break;
+			case 2:
+				test.replace();
+				break;
+			default:
+				test.remove();
+		}
+		if (round % 3 == 0) test.search();
+	}
+
+	std::printf("%d searches compared, %d differences\n", movies::checks,
+	            movies::failures);
+	return movies::failures ? 1 : 0;
+}
@@ -163,6 +163,7 @@ _interface_ext_attrs = [
     FlagArg("load_postproc"),
     FlagArg("merge_postproc"),
     FlagArg("nonjson"),
+    FlagArg("projection"),
     StringArg("cpp_quote"),
 ]
 
@@ -174,6 +175,7 @@ def interface_ext_attrs(ext_attrs: list[WidlExtAttribute]):
 _attribute_ext_attrs = [
     SingleArg("empty", ["warn", "allow"], "warn"),
     FlagArg("or_value"),
+    FlagArg("interned"),
     StringArg("load_as"),
     Guard(),
     Guards(),
@@ -186,7 +188,12 @@ def attribute_ext_attrs(ext_attrs: list[WidlExtAttribute]):
     return _ext_attrs(ext_attrs, _attribute_ext_attrs)
 
 
-_oparg_ext_attrs = [FlagArg("defaulted"), FlagArg("in"), FlagArg("out")]
+_oparg_ext_attrs = [
+    FlagArg("defaulted"),
+    FlagArg("in"),
+    FlagArg("out"),
+    FlagArg("nullable"),
+]
 _operation_ext_attrs = [
     FlagArg("mutable"),
     FlagArg("throws"),
@@ -1,4 +1,5 @@
 from .common import *
+from .projection import *
 from ...model import *
 from typing import TextIO
 from ..tmplt import TemplateContext
@@ -47,6 +48,9 @@ class AttributeInfo:
     name: str
     ext_attrs: dict
     merge_with: list[MergeWith]
+    version: int
+    fields: Optional[str] = None
+    nested: Optional[NestedFields] = None
 
     @property
     def op_load(self):
@@ -58,6 +62,26 @@ class AttributeInfo:
             else "load"
         )
 
+    @property
+    def select(self):
+        if self.fields is None:
+            return None
+        return f"any(fields & {self.fields}::{self.name})"
+
+    @property
+    def load_call(self):
+        if self.ext_attrs["load_as"]:
+            return self.ext_attrs["load_as"]
+        if self.nested is not None:
+            sub_fields = (
+                f"sub_fields<{self.nested.type}>(fields, {self.nested.offset})"
+            )
+            return (
+                f'v{self.version}::load(data, u8"{self.name}", {self.name}, '
+                f"{sub_fields}, dbg)"
+            )
+        return f'v{self.version}::{self.op_load}(data, u8"{self.name}", {self.name}, dbg)'
+
     @property
     def op_store(self):
         return "store_or_value" if self.ext_attrs["or_value"] else "store"
@@ -68,9 +92,15 @@ class InterfaceInfo:
     name: str
     add_merge: bool
     add_serdes: bool
+    add_binary: bool
     ext_attrs: dict
     attributes: list[AttributeInfo]
     merge_with: list[MergeWith]
+    projection: Optional[ProjectionInfo] = None
+
+    @property
+    def fields_type(self):
+        return self.projection.name if self.projection else None
 
     @property
     def spcs(self):
@@ -83,12 +113,19 @@ class CodeContext(TemplateContext):
         self.header = header
         self.enums: list[EnumInfo] = []
         self.interfaces: list[InterfaceInfo] = []
+        self.projections: list[ProjectionInfo] = []
 
 
 class Visitor(ClassVisitor):
-    def __init__(self, merge_with: dict[str, list[tuple[str, str]]], ctx: CodeContext):
+    def __init__(
+        self,
+        merge_with: dict[str, list[tuple[str, str]]],
+        projections: Projections,
+        ctx: CodeContext,
+    ):
         super(ClassVisitor).__init__()
         self.merge_with = merge_with
+        self.projections = projections
         self.ctx = ctx
 
     def on_interface(self, obj: WidlInterface):
@@ -104,6 +141,7 @@ class Visitor(ClassVisitor):
         del (obj_ext_attrs["merge_with"],)
         obj_ext_attrs["has_to_string"] = load_from != "none"
 
+        projection = self.projections.get(obj.name)
         attributes: list[AttributeInfo] = []
         for prop in obj.props:
             simple_type = _simple(prop.type)
@@ -111,18 +149,29 @@ class Visitor(ClassVisitor):
                 MergeWith(type_name, name)
                 for type_name, name in self.merge_with.get(simple_type, [])
             ]
-            attributes.append(AttributeInfo(prop.name, prop.ext_attrs, params))
+            attributes.append(
+                AttributeInfo(
+                    prop.name,
+                    prop.ext_attrs,
+                    params,
+                    self.ctx.version,
+                    fields=projection.name if projection else None,
+                    nested=projection.nested.get(prop.name) if projection else None,
+                )
+            )
 
         self.ctx.interfaces.append(
             InterfaceInfo(
                 obj.name,
                 add_merge=not nonjson and merge_mode == "auto",
                 add_serdes=not nonjson and load_from == "map",
+                add_binary=not nonjson and load_from != "none",
                 ext_attrs=obj_ext_attrs,
                 attributes=attributes,
                 merge_with=[
                     MergeWith(type_name, arg_name) for type_name, arg_name in merge_with
                 ],
+                projection=projection,
             )
         )
 
@@ -132,5 +181,7 @@ def print_code(objects: list[WidlClass], output: TextIO, header: str, version: i
 
     ctx = CodeContext(output, version, header)
     ctx.enums = [EnumInfo(name) for name in sorted(types.enums)]
-    Visitor(types.merge_with, ctx).visit_all(objects)
+    projections = Projections(objects)
+    ctx.projections = projections.ordered
+    Visitor(types.merge_with, projections, ctx).visit_all(objects)
     ctx.emit("code.mustache")
@@ -30,6 +30,10 @@ builtin_types = [
     "char",
     "bool",
     "alpha_2_aliases",
+    "library_manifest",
+    "load_stats",
+    "library_stream",
+    "library_watch",
     "object",
     "tuple",
     "list",
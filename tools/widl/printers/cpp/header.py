@@ -1,11 +1,17 @@
 from .common import *
+from .projection import *
 from ...model import *
 from typing import TextIO
 from ..tmplt import TemplateContext
 from dataclasses import dataclass
+import hashlib
 
 
 class CppTypes(TypeVisitor):
+    def __init__(self, interned: bool = False):
+        super().__init__()
+        self.interned = interned
+
     def on_optional(self, obj: WidlOptional):
         sub = self.on_subtype(obj)
         return f"std::optional<{sub}>"
@@ -19,14 +25,20 @@ class CppTypes(TypeVisitor):
         return f"translatable<{sub}>"
 
     def on_simple(self, obj: WidlSimple):
+        if self.interned and obj.text == "string":
+            return "interned_string"
         try:
             return simple_types[obj.text][1]
         except KeyError:
             return obj.text
 
 
-def _cpp_type(widl: WidlType):
-    return widl.on_type_visitor(CppTypes())
+def _cpp_type(widl: WidlType, interned: bool = False):
+    return widl.on_type_visitor(CppTypes(interned))
+
+
+def _prop_type(prop: WidlAttribute):
+    return _cpp_type(prop.type, prop.ext_attrs["interned"])
 
 
 class EnumInfo:
@@ -108,6 +120,31 @@ class HeaderContext(TemplateContext):
         self.includes: list[str] = []
         self.enums: list[EnumInfo] = []
         self.interfaces: list[InterfaceInfo] = []
+        self.projections: list[ProjectionInfo] = []
+        self.schema: str = "0"
+
+
+# fingerprint of everything, which affects the to_binary layout
+class BinarySchema(ClassVisitor):
+    def __init__(self):
+        super(ClassVisitor).__init__()
+        self.lines: list[str] = []
+
+    def on_enum(self, obj: WidlEnum):
+        self.lines.append(f"enum {obj.name} {{{', '.join(obj.items)}}}")
+
+    def on_interface(self, obj: WidlInterface):
+        if obj.ext_attrs["from"] == "none" or obj.ext_attrs["nonjson"]:
+            return
+        props = "; ".join(
+            f"{_prop_type(prop)} {prop.name}" for prop in obj.props
+        )
+        self.lines.append(f"struct {obj.name} {{{props}}}")
+
+    @property
+    def digest(self):
+        text = "\n".join(self.lines).encode("UTF-8")
+        return "0x{}ull".format(hashlib.sha1(text).hexdigest()[:16])
 
 
 class Visitor(TypeVisitor, ClassVisitor):
@@ -119,7 +156,9 @@ class Visitor(TypeVisitor, ClassVisitor):
         self.ctx = ctx
 
     def all_visited(self):
-        files = {*self.files, "<movies/types.hpp>"}
+        files = {*self.files, "<movies/binary.hpp>", "<movies/types.hpp>"}
+        if len(self.ctx.projections):
+            files.update({"<cstdint>", "<optional>", "<string_view>"})
         self.ctx.includes = list(sorted(files))
 
     def on_optional(self, obj: WidlOptional):
@@ -146,6 +185,8 @@ class Visitor(TypeVisitor, ClassVisitor):
 
         for prop in obj.props:
             prop.type.on_type_visitor(self)
+            if prop.ext_attrs["interned"]:
+                self.files.add("<movies/interned.hpp>")
 
             guard, guards = (prop.ext_attrs["guard"], prop.ext_attrs["guards"])
             if guard is not None:
@@ -153,7 +194,7 @@ class Visitor(TypeVisitor, ClassVisitor):
             attributes.append(
                 AttributeInfo(
                     prop.name,
-                    _cpp_type(prop.type),
+                    _prop_type(prop),
                     prop.ext_attrs["default"],
                     [*guards],
                     prop.pos,
@@ -246,6 +287,23 @@ class Visitor(TypeVisitor, ClassVisitor):
                         ],
                         obj.pos,
                     ),
+                    *self._projected_ops(obj, load_from),
+                    OperationInfo(
+                        "to_binary",
+                        "void",
+                        [],
+                        {"throws": True},
+                        [ArgumentInfo("out", "binary_writer", {"out": True})],
+                        obj.pos,
+                    ),
+                    OperationInfo(
+                        "from_binary",
+                        "bool",
+                        [],
+                        {"throws": True, "mutable": True},
+                        [ArgumentInfo("in", "binary_reader", {"out": True})],
+                        obj.pos,
+                    ),
                 ]
             )
 
@@ -293,11 +351,33 @@ class Visitor(TypeVisitor, ClassVisitor):
 
         return initial
 
+    def _projected_ops(self, obj: WidlInterface, load_from: str):
+        if not obj.ext_attrs["projection"]:
+            return []
+        return [
+            OperationInfo(
+                "from_json",
+                "json::conv_result",
+                [],
+                {"throws": True, "mutable": True},
+                [
+                    ArgumentInfo("data", f"json::{load_from}", {"in": True}),
+                    ArgumentInfo("dbg", "std::string", {"out": True, "in": True}),
+                    ArgumentInfo("fields", f"{obj.name}_fields", {}),
+                ],
+                obj.pos,
+            )
+        ]
+
     def on_enum(self, obj: WidlEnum):
         self.ctx.enums.append(EnumInfo(obj.name, obj.items, obj.ext_attrs))
 
 
 def print_header(objects: list[WidlClass], output: TextIO, version: int):
     ctx = HeaderContext(output, version)
-    Visitor([obj.name for obj in objects], ctx).visit_all(objects)
+    ctx.projections = Projections(objects).ordered
+    project_types = [obj.name for obj in objects]
+    project_types.extend(info.name for info in ctx.projections)
+    Visitor(project_types, ctx).visit_all(objects)
+    ctx.schema = BinarySchema().visit_all(objects).digest
     ctx.emit("header.mustache")
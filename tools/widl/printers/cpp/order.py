@@ -120,6 +120,8 @@ class ClassDependencies(TypeVisitor, ClassVisitor):
         self.current: str = ""
         self.types: Dict[str, WidlClass] = {}
         self.system = type_system()
+        # declared ahead of all the classes, see projection.py
+        self.projections: Set[str] = set()
 
     def declaration_order(self):
         order = self.system.order()
@@ -130,7 +132,7 @@ class ClassDependencies(TypeVisitor, ClassVisitor):
             simple_types[obj.text]
             return
         except:
-            if obj.text in builtin_types:
+            if obj.text in builtin_types or obj.text in self.projections:
                 return
             self.system.register(self.current, obj.text)
 
@@ -156,5 +158,10 @@ class ClassDependencies(TypeVisitor, ClassVisitor):
 
 def reorder_types(objects: list[WidlClass]):
     deps = ClassDependencies()
+    deps.projections = {
+        f"{obj.name}_fields"
+        for obj in objects
+        if isinstance(obj, WidlInterface) and obj.ext_attrs["projection"]
+    }
     deps.visit_all(objects)
     objects[:] = deps.declaration_order()
@@ -0,0 +1,95 @@
+from ...model import *
+from dataclasses import dataclass, field
+from typing import Optional
+
+
+class ExtractDirectType(TypeVisitor):
+    def on_simple(self, obj: WidlSimple):
+        return obj.text
+
+    def on_complex(self, obj: WidlComplex):
+        return None
+
+
+@dataclass
+class FieldBit:
+    name: str
+    value: str
+
+
+@dataclass
+class NestedFields:
+    type: str
+    offset: int
+
+
+@dataclass
+class ProjectionInfo:
+    owner: str
+    bits: list[FieldBit] = field(default_factory=list)
+    # attribute name -> position of its first bit, for nested projections
+    nested: dict[str, NestedFields] = field(default_factory=dict)
+    count: int = 0
+
+    @property
+    def name(self):
+        return f"{self.owner}_fields"
+
+    @property
+    def all(self):
+        return f"(1ull << {self.count}) - 1"
+
+
+# One bit per attribute of an interface marked with [projection]. An
+# attribute, which is itself a [projection] interface, gets a bit for each of
+# its own attributes (prefixed with its name) and a combined mask under its
+# own name.
+class Projections:
+    def __init__(self, objects: list[WidlClass]):
+        self.interfaces: dict[str, WidlInterface] = {
+            obj.name: obj
+            for obj in objects
+            if isinstance(obj, WidlInterface) and obj.ext_attrs["projection"]
+        }
+        self.infos: dict[str, ProjectionInfo] = {}
+        self.ordered: list[ProjectionInfo] = []
+        for name in self.interfaces:
+            self._build(name)
+
+    def get(self, name: str) -> Optional[ProjectionInfo]:
+        return self.infos.get(name)
+
+    def _build(self, name: str) -> ProjectionInfo:
+        try:
+            return self.infos[name]
+        except KeyError:
+            pass
+
+        obj = self.interfaces[name]
+        info = ProjectionInfo(name)
+        for prop in obj.props:
+            sub_name = prop.type.on_type_visitor(ExtractDirectType())
+            if sub_name not in self.interfaces:
+                info.bits.append(FieldBit(prop.name, f"1ull << {info.count}"))
+                info.count += 1
+                continue
+
+            sub = self._build(sub_name)
+            info.nested[prop.name] = NestedFields(sub.name, info.count)
+            leaves: list[str] = []
+            for bit in sub.bits:
+                value = bit.value
+                if value.startswith("1ull << "):
+                    value = f"1ull << {info.count + int(value[8:])}"
+                    leaves.append(f"{prop.name}_{bit.name}")
+                else:
+                    value = " | ".join(
+                        f"{prop.name}_{part}" for part in value.split(" | ")
+                    )
+                info.bits.append(FieldBit(f"{prop.name}_{bit.name}", value))
+            info.bits.append(FieldBit(prop.name, " | ".join(leaves)))
+            info.count += sub.count
+
+        self.infos[name] = info
+        self.ordered.append(info)
+        return info
@@ -147,7 +147,14 @@ class CodeContext(TemplateContext):
 class PythonInterface(TypeVisitor):
     def __init__(self, project_types: dict[str, bool]):
         self.project_types = project_types
-        self.typing: set[str] = {"Iterator", "Generic", "TypeVar"}
+        self.typing: set[str] = {
+            "Callable",
+            "Iterator",
+            "Generic",
+            "Tuple",
+            "TypeVar",
+            "Union",
+        }
         self.vectors: set[str] = set()
         self.translatables: set[str] = set()
         self.in_vector = 0